@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    BandCompressor.h
+
+    Same compressor as juce::dsp::Compressor (peak ballistics envelope into a
+    hard-knee gain computer), but owning its envelope so the envelope can go
+    into a DSP state snapshot.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace params
+{
+    class BandCompressor
+    {
+    public:
+        BandCompressor()
+        {
+            update();
+        }
+
+        void setThreshold(float newThreshold)
+        {
+            thresholddB = newThreshold;
+            update();
+        }
+
+        void setRatio(float newRatio)
+        {
+            jassert(newRatio >= 1.f);
+
+            ratio = newRatio;
+            update();
+        }
+
+        void setAttack(float newAttack)
+        {
+            attackTime = newAttack;
+            update();
+        }
+
+        void setRelease(float newRelease)
+        {
+            releaseTime = newRelease;
+            update();
+        }
+
+        void prepare(const juce::dsp::ProcessSpec& spec)
+        {
+            jassert(spec.sampleRate > 0);
+            jassert(spec.numChannels > 0);
+
+            expFactor = -2.0 * juce::MathConstants<double>::pi * 1000.0 / spec.sampleRate;
+            envelope.resize(spec.numChannels);
+
+            update();
+            reset();
+        }
+
+        void reset()
+        {
+            std::fill(envelope.begin(), envelope.end(), 0.f);
+        }
+
+        template <typename ProcessContext>
+        void process(const ProcessContext& context) noexcept
+        {
+            const auto& inputBlock = context.getInputBlock();
+            auto& outputBlock = context.getOutputBlock();
+            const auto numChannels = outputBlock.getNumChannels();
+            const auto numSamples = outputBlock.getNumSamples();
+
+            jassert(inputBlock.getNumChannels() == numChannels);
+            jassert(inputBlock.getNumSamples() == numSamples);
+
+            if (context.isBypassed)
+            {
+                outputBlock.copyFrom(inputBlock);
+                return;
+            }
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto* inputSamples = inputBlock.getChannelPointer(channel);
+                auto* outputSamples = outputBlock.getChannelPointer(channel);
+
+                for (size_t i = 0; i < numSamples; ++i)
+                {
+                    outputSamples[i] = processSample(static_cast<int>(channel), inputSamples[i]);
+                }
+            }
+        }
+
+        float processSample(int channel, float inputValue)
+        {
+            // peak rectifier into the ballistics filter
+            auto& env = envelope[static_cast<size_t>(channel)];
+            auto rectified = std::abs(inputValue);
+            auto cte = rectified > env ? attackCoefficient : releaseCoefficient;
+            env = rectified + cte * (env - rectified);
+
+            auto gain = env < threshold ? 1.f : std::pow(env * thresholdInverse, ratioInverse - 1.f);
+
+            return gain * inputValue;
+        }
+
+        void writeState(juce::OutputStream& stream) const
+        {
+            stream.writeInt(static_cast<int>(envelope.size()));
+
+            for (auto value : envelope)
+            {
+                stream.writeFloat(value);
+            }
+        }
+
+        // Fails if the state was written by a compressor with another channel count.
+        bool readState(juce::InputStream& stream)
+        {
+            auto numChannels = stream.readInt();
+            if (numChannels != static_cast<int>(envelope.size())
+                || stream.getNumBytesRemaining() < static_cast<juce::int64>(envelope.size() * sizeof(float)))
+                return false;
+
+            for (auto& value : envelope)
+            {
+                value = stream.readFloat();
+            }
+
+            return true;
+        }
+
+    private:
+        void update()
+        {
+            threshold = juce::Decibels::decibelsToGain(thresholddB, -200.f);
+            thresholdInverse = 1.f / threshold;
+            ratioInverse = 1.f / ratio;
+
+            attackCoefficient = calculateCoefficient(attackTime);
+            releaseCoefficient = calculateCoefficient(releaseTime);
+        }
+
+        float calculateCoefficient(float timeMs) const
+        {
+            return timeMs < 1.0e-3f ? 0.f : static_cast<float>(std::exp(expFactor / timeMs));
+        }
+
+        float threshold{ 1.f }, thresholdInverse{ 1.f }, ratioInverse{ 1.f };
+        float attackCoefficient{ 0.f }, releaseCoefficient{ 0.f };
+        std::vector<float> envelope;
+
+        double expFactor{ -0.142 };
+        float thresholddB{ 0.f }, ratio{ 1.f }, attackTime{ 1.f }, releaseTime{ 100.f };
+    };
+}
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    CrossoverFilter.h
+
+    Same Linkwitz-Riley filter as juce::dsp::LinkwitzRileyFilter, but with
+    its state readable and writable so it can go into a DSP state snapshot.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace params
+{
+    class CrossoverFilter
+    {
+    public:
+        using Type = juce::dsp::LinkwitzRileyFilterType;
+
+        CrossoverFilter()
+        {
+            update();
+        }
+
+        void setType(Type newType)
+        {
+            filterType = newType;
+        }
+
+        void setCutoffFrequency(float newCutoffFrequency)
+        {
+            jassert(juce::isPositiveAndBelow(newCutoffFrequency, static_cast<float>(sampleRate * 0.5)));
+
+            cutoffFrequency = newCutoffFrequency;
+            update();
+        }
+
+        void prepare(const juce::dsp::ProcessSpec& spec)
+        {
+            jassert(spec.sampleRate > 0);
+            jassert(spec.numChannels > 0);
+
+            sampleRate = spec.sampleRate;
+            update();
+
+            for (auto* state : { &s1, &s2, &s3, &s4 })
+            {
+                state->resize(spec.numChannels);
+            }
+
+            reset();
+        }
+
+        void reset()
+        {
+            for (auto* state : { &s1, &s2, &s3, &s4 })
+            {
+                std::fill(state->begin(), state->end(), 0.f);
+            }
+        }
+
+        template <typename ProcessContext>
+        void process(const ProcessContext& context) noexcept
+        {
+            const auto& inputBlock = context.getInputBlock();
+            auto& outputBlock = context.getOutputBlock();
+            const auto numChannels = outputBlock.getNumChannels();
+            const auto numSamples = outputBlock.getNumSamples();
+
+            jassert(inputBlock.getNumChannels() <= s1.size());
+            jassert(inputBlock.getNumChannels() == numChannels);
+            jassert(inputBlock.getNumSamples() == numSamples);
+
+            if (context.isBypassed)
+            {
+                outputBlock.copyFrom(inputBlock);
+                return;
+            }
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto* inputSamples = inputBlock.getChannelPointer(channel);
+                auto* outputSamples = outputBlock.getChannelPointer(channel);
+
+                for (size_t i = 0; i < numSamples; ++i)
+                {
+                    outputSamples[i] = processSample(static_cast<int>(channel), inputSamples[i]);
+                }
+            }
+
+           #if JUCE_DSP_ENABLE_SNAP_TO_ZERO
+            snapToZero();
+           #endif
+        }
+
+        float processSample(int channel, float inputValue)
+        {
+            auto& z1 = s1[static_cast<size_t>(channel)];
+            auto& z2 = s2[static_cast<size_t>(channel)];
+
+            auto yH = (inputValue - (R2 + g) * z1 - z2) * h;
+
+            auto yB = g * yH + z1;
+            z1 = g * yH + yB;
+
+            auto yL = g * yB + z2;
+            z2 = g * yB + yL;
+
+            if (filterType == Type::allpass)
+                return yL - R2 * yB + yH;
+
+            auto& z3 = s3[static_cast<size_t>(channel)];
+            auto& z4 = s4[static_cast<size_t>(channel)];
+
+            auto yH2 = ((filterType == Type::lowpass ? yL : yH) - (R2 + g) * z3 - z4) * h;
+
+            auto yB2 = g * yH2 + z3;
+            z3 = g * yH2 + yB2;
+
+            auto yL2 = g * yB2 + z4;
+            z4 = g * yB2 + yL2;
+
+            return filterType == Type::lowpass ? yL2 : yH2;
+        }
+
+        void snapToZero() noexcept
+        {
+            for (auto* state : { &s1, &s2, &s3, &s4 })
+            {
+                for (auto& element : *state)
+                {
+                    juce::dsp::util::snapToZero(element);
+                }
+            }
+        }
+
+        void writeState(juce::OutputStream& stream) const
+        {
+            stream.writeInt(static_cast<int>(s1.size()));
+
+            for (auto* state : { &s1, &s2, &s3, &s4 })
+            {
+                for (auto value : *state)
+                {
+                    stream.writeFloat(value);
+                }
+            }
+        }
+
+        // Fails if the state was written by a filter with another channel count.
+        bool readState(juce::InputStream& stream)
+        {
+            auto numChannels = stream.readInt();
+            if (numChannels != static_cast<int>(s1.size())
+                || stream.getNumBytesRemaining() < static_cast<juce::int64>(4 * s1.size() * sizeof(float)))
+                return false;
+
+            for (auto* state : { &s1, &s2, &s3, &s4 })
+            {
+                for (auto& value : *state)
+                {
+                    value = stream.readFloat();
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        void update()
+        {
+            g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoffFrequency / sampleRate));
+            R2 = static_cast<float>(std::sqrt(2.0));
+            h = static_cast<float>(1.0 / (1.0 + R2 * g + g * g));
+        }
+
+        float g{ 0.f }, R2{ 0.f }, h{ 0.f };
+        std::vector<float> s1, s2, s3, s4;
+
+        double sampleRate{ 44100.0 };
+        float cutoffFrequency{ 2000.f };
+        Type filterType{ Type::lowpass };
+    };
+}
@@ -11,6 +11,13 @@
 
 using namespace params;
 
+namespace
+{
+    // getDspState blobs start with "MBCS" and a version, bump it whenever the layout changes
+    constexpr int dspStateMagic = 0x5343424d;
+    constexpr int dspStateVersion = 1;
+}
+
 //==============================================================================
 MultiBandCompressorAudioProcessor::MultiBandCompressorAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -75,6 +82,26 @@ MultiBandCompressorAudioProcessor::MultiBandCompressorAudioProcessor()
     floatHelper(lowMidCrossover, Names::lowMidCrossoverFreq);
     floatHelper(midHighCrossover, Names::midHighCrossoverFreq);
 
+    boolHelper(pipelinedParam, Names::pipelinedProcessing);
+
+    boolHelper(spectralModeParam, Names::spectralMode);
+    spectralBandCountParam =
+        dynamic_cast<juce::AudioParameterInt*>(aptvs.getParameter(params.at(Names::spectralBandCount)));
+    jassert(spectralBandCountParam != nullptr);
+
+    for (int band = 0; band < SpectralCompressor::maxBands; ++band)
+    {
+        auto& param = spectralThresholdOffsetParams[static_cast<size_t>(band)];
+        param = dynamic_cast<juce::AudioParameterFloat*>(
+            aptvs.getParameter(GetSpectralBandParam(Names::spectralThresholdOffset, band)));
+        jassert(param != nullptr);
+    }
+
+    boolHelper(qualityGovernorParam, Names::qualityGovernor);
+    choiceHelper(qualityTierParam, Names::qualityTier);
+
+    reducedSpectralCompressor.setHopSize(SpectralCompressor::fftSize / 2);
+
     LP1.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
     HP1.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
 
@@ -83,10 +110,16 @@ MultiBandCompressorAudioProcessor::MultiBandCompressorAudioProcessor()
     LP2.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
     HP2.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
 
+    aptvs.addParameterListener(params.at(Names::pipelinedProcessing), this);
+
 }
 
 MultiBandCompressorAudioProcessor::~MultiBandCompressorAudioProcessor()
 {
+    aptvs.removeParameterListener(GetParams().at(Names::pipelinedProcessing), this);
+    cancelPendingUpdate();
+
+    stopPipelineThread();
 }
 
 //==============================================================================
@@ -140,15 +173,18 @@ int MultiBandCompressorAudioProcessor::getCurrentProgram()
 
 void MultiBandCompressorAudioProcessor::setCurrentProgram (int index)
 {
+    juce::ignoreUnused (index);
 }
 
 const juce::String MultiBandCompressorAudioProcessor::getProgramName (int index)
 {
+    juce::ignoreUnused (index);
     return {};
 }
 
 void MultiBandCompressorAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    juce::ignoreUnused (index, newName);
 }
 
 //==============================================================================
@@ -157,9 +193,15 @@ void MultiBandCompressorAudioProcessor::prepareToPlay (double sampleRate, int sa
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
+    // the worker must not touch the DSP state while it is being prepared
+    isPrepared = false;
+    stopPipelineThread();
+
+    preparedSampleRate = sampleRate;
+
     juce::dsp::ProcessSpec processSpec;
-    processSpec.maximumBlockSize = samplesPerBlock;
-    processSpec.numChannels = getTotalNumOutputChannels();
+    processSpec.maximumBlockSize = static_cast<juce::uint32>(samplesPerBlock);
+    processSpec.numChannels = static_cast<juce::uint32>(getTotalNumOutputChannels());
     processSpec.sampleRate = sampleRate;
 
     for (auto& compressor : compressors)
@@ -177,15 +219,50 @@ void MultiBandCompressorAudioProcessor::prepareToPlay (double sampleRate, int sa
 
     for (auto& buffer : filterBuffers) 
     {
-        buffer.setSize(processSpec.numChannels, samplesPerBlock);
+        buffer.setSize(getTotalNumOutputChannels(), samplesPerBlock);
+    }
+
+    spectralCompressor.prepare(processSpec);
+    reducedSpectralCompressor.prepare(processSpec);
+
+    governor.prepare(sampleRate);
+    activeTier = QualityGovernor::full;
+    fadingFromTier = -1;
+    publishedTier = QualityGovernor::full;
+
+    tierBuffer.setSize(getTotalNumOutputChannels(), samplesPerBlock);
+    latencyBuffer.setSize(getTotalNumOutputChannels(), SpectralCompressor::getLatencyInSamples());
+    latencyBuffer.clear();
+    latencyBufferPosition = 0;
+
+    for (auto& buffer : pipelineBuffers)
+    {
+        buffer.setSize(getTotalNumOutputChannels(), samplesPerBlock);
     }
 
+    // The worker gets a quarter of a block on top of the time until its
+    // result is due. Past that the audio thread stops waiting for it.
+    pipelineTimeoutTicks = juce::Time::secondsToHighResolutionTicks(0.25 * samplesPerBlock / sampleRate);
+
+    resetPipeline();
+
+    isPrepared = true;
+    updatePipelineThread();
+
+    spectralModeActive = spectralModeParam->get();
+    pipelineActive = pipelinedParam->get() && pipelineThread.isThreadRunning();
+    updateLatency();
+    reportToHost();
+
 }
 
 void MultiBandCompressorAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+
+    isPrepared = false;
+    stopPipelineThread();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -216,6 +293,8 @@ bool MultiBandCompressorAudioProcessor::isBusesLayoutSupported (const BusesLayou
 
 void MultiBandCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    juce::ignoreUnused (midiMessages);
+
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -229,29 +308,370 @@ void MultiBandCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>&
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    for (auto& compressor : compressors)
+    if (buffer.getNumSamples() == 0)
+        return;
+
+    // If the worker is still busy with its last chunk the switch is left to
+    // a later block, the audio thread and the worker never run the chain together.
+    auto pipelined = pipelinedParam->get() && pipelineThread.isThreadRunning();
+    if (pipelined != pipelineActive
+        && waitForPipelineChunks(pipelineSubmitted.load(std::memory_order_relaxed),
+                                 juce::Time::getHighResolutionTicks() + pipelineTimeoutTicks))
     {
-        compressor.updateCompressorSettings();
+        resetPipeline();
+
+        pipelineActive = pipelined;
+        updateLatency();
     }
- 
-    for (auto& fb : filterBuffers)
+
+    if (pipelineActive)
+    {
+        processPipelined(buffer);
+    }
+    else
+    {
+        processChain(buffer);
+    }
+
+    reportToHost();
+}
+
+void MultiBandCompressorAudioProcessor::processChain(juce::AudioBuffer<float>& buffer)
+{
+    auto totalNumInputChannels = getTotalNumInputChannels();
+    auto numSamples = buffer.getNumSamples();
+
+    QualityGovernor::ScopedMeasurement measurement(governor, numSamples, isGoverned());
+
+    // A single NaN or Inf would get stuck in the filter and envelope state
+    // and keep the output broken until the plugin is reloaded. Anything beyond
+    // +60 dBFS can only be garbage too, and squaring it for the spectral band
+    // energies would overflow.
+    constexpr auto maxInputLevel = 1000.f;
+
+    for (int channel = 0; channel < totalNumInputChannels; ++channel)
     {
-        fb = buffer;
+        auto* channelData = buffer.getWritePointer (channel);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            channelData[i] = std::isfinite(channelData[i]) ? juce::jlimit(-maxInputLevel, maxInputLevel, channelData[i])
+                                                           : 0.f;
+        }
+    }
+
+    if (spectralModeParam->get())
+    {
+        processSpectral(buffer);
+    }
+    else
+    {
+        if (spectralModeActive)
+        {
+            spectralModeActive = false;
+            updateLatency();
+        }
+
+        // the crossover path has no cheaper tier to fall back to
+        governor.reset();
+        activeTier = QualityGovernor::full;
+        fadingFromTier = -1;
+
+        updateBandSettings();
+        processCrossover(buffer);
     }
 
-    auto lowMidCutoffFreq = lowMidCrossover->get();
+    publishedTier = activeTier;
+}
+
+void MultiBandCompressorAudioProcessor::processPipelined(juce::AudioBuffer<float>& buffer)
+{
+    auto callbackStartTicks = juce::Time::getHighResolutionTicks();
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), pipelineBuffers[0].getNumChannels());
+    auto chunkSize = pipelineBuffers[0].getNumSamples();
+
+    // Input is collected into chunks of the prepared block size. Every full
+    // chunk goes to the worker and its result plays while the next one is
+    // collected. A result that is late is played as silence and dropped, never
+    // played later, so the output stays in time and the chain still gets every
+    // chunk of input.
+    for (int startSample = 0; startSample < numSamples;)
+    {
+        if (pipelinePosition == 0)
+        {
+            pipelineOutputSlot = -1;
+
+            if (pipelineResultPending)
+            {
+                // The result is due where this chunk starts in the callback, a
+                // later chunk in a large host block may be waited for that much longer.
+                // Offline there is no deadline to keep.
+                auto deadline = isNonRealtime() ? std::numeric_limits<juce::int64>::max()
+                                                : callbackStartTicks + pipelineTimeoutTicks
+                                                      + juce::Time::secondsToHighResolutionTicks(startSample / preparedSampleRate);
+                auto submitted = pipelineSubmitted.load(std::memory_order_relaxed);
+
+                if (waitForPipelineChunks(submitted, deadline))
+                {
+                    pipelineOutputSlot = static_cast<int>((submitted - 1) % numPipelineSlots);
+                }
+                else
+                {
+                    pipelineOverruns.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                pipelineResultPending = false;
+            }
+
+            // Only when the worker is a whole ring behind is the slot for this
+            // chunk still in use. Its input is lost then, and its result plays
+            // as silence a chunk later.
+            pipelineDroppingChunk = pipelineSubmitted.load(std::memory_order_relaxed)
+                                  - pipelineCompleted.load(std::memory_order_acquire) >= numPipelineSlots;
+
+            if (pipelineDroppingChunk)
+            {
+                pipelineOverruns.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        auto fillSlot = pipelineSubmitted.load(std::memory_order_relaxed) % numPipelineSlots;
+        auto& fill = pipelineBuffers[static_cast<size_t>(fillSlot)];
+        auto segmentSize = juce::jmin(numSamples - startSample, chunkSize - pipelinePosition);
+
+        for (auto ch = 0; ch < numChannels; ++ch)
+        {
+            if (!pipelineDroppingChunk)
+            {
+                fill.copyFrom(ch, pipelinePosition, buffer, ch, startSample, segmentSize);
+            }
+
+            if (pipelineOutputSlot >= 0)
+            {
+                buffer.copyFrom(ch, startSample, pipelineBuffers[static_cast<size_t>(pipelineOutputSlot)], ch, pipelinePosition, segmentSize);
+            }
+            else
+            {
+                buffer.clear(ch, startSample, segmentSize);
+            }
+        }
+
+        pipelinePosition += segmentSize;
+        startSample += segmentSize;
+
+        if (pipelinePosition == chunkSize)
+        {
+            if (!pipelineDroppingChunk)
+            {
+                pipelineSubmitted.fetch_add(1, std::memory_order_release);
+                pipelineSignal.signal();
+                pipelineResultPending = true;
+            }
+
+            pipelinePosition = 0;
+        }
+    }
+}
+
+// Runs the chain over every submitted chunk that has not been processed yet.
+// The worker calls this, and so does the audio thread while there is no
+// worker. Whoever claims pipelineChainBusy first does the work, the other
+// returns false, so the chain never runs on two threads at once.
+bool MultiBandCompressorAudioProcessor::processPipelineChunks()
+{
+    if (pipelineChainBusy.exchange(true, std::memory_order_acquire))
+        return false;
+
+    for (auto chunk = pipelineCompleted.load(std::memory_order_relaxed);
+         chunk < pipelineSubmitted.load(std::memory_order_acquire); ++chunk)
+    {
+        processChain(pipelineBuffers[static_cast<size_t>(chunk % numPipelineSlots)]);
+        pipelineCompleted.store(chunk + 1, std::memory_order_release);
+    }
+
+    pipelineChainBusy.store(false, std::memory_order_release);
+    return true;
+}
+
+// False if fewer than numChunks chunks have been completed by the deadline.
+bool MultiBandCompressorAudioProcessor::waitForPipelineChunks(juce::int64 numChunks, juce::int64 deadline)
+{
+    while (pipelineCompleted.load(std::memory_order_acquire) < numChunks)
+    {
+        // without a worker nobody else is going to process them
+        if (!pipelineThread.isThreadRunning() && processPipelineChunks())
+            continue;
+
+        if (juce::Time::getHighResolutionTicks() >= deadline)
+            return false;
+
+        juce::Thread::yield();
+    }
+
+    return true;
+}
+
+// Only called while the worker has nothing left to do. The chunk counters
+// keep counting, so a chunk submitted before can never be taken for a new one.
+void MultiBandCompressorAudioProcessor::resetPipeline()
+{
+    for (auto& buffer : pipelineBuffers)
+    {
+        buffer.clear();
+    }
+
+    pipelinePosition = 0;
+    pipelineOutputSlot = -1;
+    pipelineResultPending = false;
+    pipelineDroppingChunk = false;
+}
+
+void MultiBandCompressorAudioProcessor::updatePipelineThread()
+{
+    if (pipelinedParam->get() && isPrepared)
+    {
+        pipelineThread.startThread(juce::Thread::Priority::highest);
+    }
+    else
+    {
+        stopPipelineThread();
+    }
+}
+
+void MultiBandCompressorAudioProcessor::stopPipelineThread()
+{
+    // The worker sleeps until it is signalled, so it has to be woken to exit.
+    // A chunk handed over just before is either finished by the worker first
+    // or picked up by the audio thread once the worker is gone.
+    pipelineThread.signalThreadShouldExit();
+    pipelineSignal.signal();
+    pipelineThread.stopThread(1000);
+}
+
+void MultiBandCompressorAudioProcessor::updateLatency()
+{
+    auto latency = spectralModeActive ? SpectralCompressor::getLatencyInSamples() : 0;
+
+    if (pipelineActive)
+    {
+        latency += pipelineBuffers[0].getNumSamples();
+    }
+
+    publishedLatency = latency;
+}
+
+void MultiBandCompressorAudioProcessor::reportToHost()
+{
+    auto latency = publishedLatency.load();
+    if (getLatencySamples() != latency)
+    {
+        setLatencySamples(latency);
+    }
+
+    // read-only, only ever written here so hosts can display the current tier
+    auto tier = publishedTier.load();
+    if (qualityTierParam->getIndex() != tier)
+    {
+        *qualityTierParam = tier;
+    }
+}
+
+void MultiBandCompressorAudioProcessor::parameterChanged(const juce::String&, float)
+{
+    // Only Pipelined Processing is listened to. Starting and stopping a thread
+    // can block, so that is left to the message thread.
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        updatePipelineThread();
+    }
+    else
+    {
+        triggerAsyncUpdate();
+    }
+}
+
+void MultiBandCompressorAudioProcessor::handleAsyncUpdate()
+{
+    updatePipelineThread();
+}
+
+MultiBandCompressorAudioProcessor::PipelineThread::PipelineThread(MultiBandCompressorAudioProcessor& p)
+    : juce::Thread("MultiBand Compressor DSP"), processor(p)
+{
+}
+
+void MultiBandCompressorAudioProcessor::PipelineThread::run()
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    // One post per chunk, but a single wake-up processes everything that is
+    // pending, so a post for a chunk already done only costs an empty pass.
+    while (!threadShouldExit())
+    {
+        processor.pipelineSignal.wait();
+        processor.processPipelineChunks();
+    }
+}
+
+void MultiBandCompressorAudioProcessor::updateBandSettings()
+{
+    for (auto& compressor : compressors)
+    {
+        compressor.updateCompressorSettings();
+    }
+
+    // The filters turn unstable at or above Nyquist, which the Mid-High
+    // range reaches at sample rates below 40 kHz.
+    auto maxCutoffFreq = static_cast<float>(preparedSampleRate * 0.49);
+
+    auto lowMidCutoffFreq = juce::jmin(lowMidCrossover->get(), maxCutoffFreq);
     LP1.setCutoffFrequency(lowMidCutoffFreq);
     HP1.setCutoffFrequency(lowMidCutoffFreq);
 
-    auto midHighCutoffFreq = midHighCrossover->get();
-    AP2.setCutoffFrequency(midHighCrossoverFreq);
-    LP2.setCutoffFrequency(midHighCrossoverFreq);
-    HP2.setCutoffFrequency(midHighCrossoverFreq);
+    auto midHighCutoffFreq = juce::jmin(midHighCrossover->get(), maxCutoffFreq);
+    AP2.setCutoffFrequency(midHighCutoffFreq);
+    LP2.setCutoffFrequency(midHighCutoffFreq);
+    HP2.setCutoffFrequency(midHighCutoffFreq);
+}
+
+void MultiBandCompressorAudioProcessor::processCrossover(juce::AudioBuffer<float>& buffer)
+{
+    auto numSamples = buffer.getNumSamples();
+
+    // Hosts may send more samples than announced in prepareToPlay, so the
+    // block is split rather than letting the filter buffers grow on the audio thread.
+    auto maxBlockSize = filterBuffers[0].getNumSamples();
+    jassert(maxBlockSize > 0);
+    if (maxBlockSize == 0)
+        return;
+
+    for (int startSample = 0; startSample < numSamples; startSample += maxBlockSize)
+    {
+        processBands(buffer, startSample, juce::jmin(maxBlockSize, numSamples - startSample));
+    }
+}
+
+void MultiBandCompressorAudioProcessor::processBands(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    auto numChannels = juce::jmin(buffer.getNumChannels(), filterBuffers[0].getNumChannels());
+
+    for (auto ch = 0; ch < numChannels; ++ch)
+    {
+        filterBuffers[0].copyFrom(ch, 0, buffer, ch, startSample, numSamples);
+        filterBuffers[1].copyFrom(ch, 0, buffer, ch, startSample, numSamples);
+    }
 
+    auto bandBlock = [nc = numChannels, ns = numSamples](auto& filterBuffer)
+    {
+        return juce::dsp::AudioBlock<float>(filterBuffer)
+            .getSubsetChannelBlock(0, static_cast<size_t>(nc))
+            .getSubBlock(0, static_cast<size_t>(ns));
+    };
 
-    auto fb0Block = juce::dsp::AudioBlock<float>(filterBuffers[0]);
-    auto fb1Block = juce::dsp::AudioBlock<float>(filterBuffers[1]);
-    auto fb2Block = juce::dsp::AudioBlock<float>(filterBuffers[2]);
+    auto fb0Block = bandBlock(filterBuffers[0]);
+    auto fb1Block = bandBlock(filterBuffers[1]);
+    auto fb2Block = bandBlock(filterBuffers[2]);
 
 
     auto fb0Context = juce::dsp::ProcessContextReplacing<float>(fb0Block);
@@ -262,27 +682,23 @@ void MultiBandCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>&
     AP2.process(fb0Context);
 
     HP1.process(fb1Context);
-     
-    filterBuffers[2] = filterBuffers[1];
+
+    fb2Block.copyFrom(fb1Block);
 
     LP2.process(fb1Context);
     HP2.process(fb2Context);
 
-    for (size_t i = 0; i < filterBuffers.size(); ++i) 
-    {
-        compressors[i].process(filterBuffers[i]);
-    }
-
-    auto numSamples = buffer.getNumSamples();
-    auto numChannels = buffer.getNumChannels();
+    compressors[0].process(fb0Block);
+    compressors[1].process(fb1Block);
+    compressors[2].process(fb2Block);
 
-    buffer.clear();
+    buffer.clear(startSample, numSamples);
 
-    auto addFilterBand = [nc = numChannels, ns = numSamples](auto& inputBuffer, const auto& source)
+    auto addFilterBand = [nc = numChannels, ns = numSamples, ss = startSample](auto& inputBuffer, const auto& source)
     {
         for (auto i = 0; i < nc; ++i)
         {
-            inputBuffer.addFrom(i, 0, source, i, 0, ns);
+            inputBuffer.addFrom(i, ss, source, i, 0, ns);
         }
     };
 
@@ -296,7 +712,7 @@ void MultiBandCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>&
         }
     }
 
-    if (bandsAreSoloed = true)
+    if (bandsAreSoloed)
     {
         for (size_t i = 0; i < compressors.size(); ++i)
         {
@@ -318,21 +734,353 @@ void MultiBandCompressorAudioProcessor::processBlock (juce::AudioBuffer<float>&
             }
         }
     }
+}
 
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+void MultiBandCompressorAudioProcessor::processSpectral(juce::AudioBuffer<float>& buffer)
+{
+    // Without this the governor would keep counting while it is off and could
+    // step down straight away, on stale load, the moment it is switched on.
+    auto governed = isGoverned();
+    if (!governed)
     {
-        auto* channelData = buffer.getWritePointer (channel);
+        governor.reset();
+    }
+
+    auto requestedTier = governed ? governor.getTier() : QualityGovernor::full;
+
+    if (!spectralModeActive)
+    {
+        // the FIFOs still hold audio from the last time the mode was on
+        activeTier = requestedTier;
+        fadingFromTier = -1;
+        resetTier(activeTier);
+
+        spectralModeActive = true;
+        updateLatency();
+    }
+
+    auto bandsAreSoloed = false;
+    for (auto& compressor : compressors)
+    {
+        if (compressor.solo->get())
+        {
+            bandsAreSoloed = true;
+            break;
+        }
+    }
+
+    std::array<SpectralRegion, 3> regions;
+    for (size_t i = 0; i < compressors.size(); ++i)
+    {
+        auto& compressor = compressors[i];
+        auto& region = regions[i];
+
+        region.threshold = compressor.threshold->get();
+        region.attack = compressor.attack->get();
+        region.release = compressor.release->get();
+        region.ratio = compressor.ratio->getCurrentChoiceName().getFloatValue();
+        region.bypassed = compressor.bypassed->get();
+        region.audible = bandsAreSoloed ? compressor.solo->get() : !compressor.mute->get();
+    }
+
+    std::array<float, SpectralCompressor::maxBands> thresholdOffsets;
+    for (size_t band = 0; band < thresholdOffsets.size(); ++band)
+    {
+        thresholdOffsets[band] = spectralThresholdOffsetParams[band]->get();
+    }
+
+    for (auto* engine : { &spectralCompressor, &reducedSpectralCompressor })
+    {
+        engine->setNumBands(spectralBandCountParam->get());
+        engine->setCrossovers(lowMidCrossover->get(), midHighCrossover->get());
+        engine->setRegions(regions);
+        engine->setBandThresholdOffsets(thresholdOffsets);
+    }
+
+    updateBandSettings();
+
+    if (fadingFromTier < 0 && requestedTier != activeTier)
+    {
+        fadingFromTier = activeTier;
+        activeTier = requestedTier;
+        transitionPosition = 0;
+        resetTier(activeTier);
+    }
+
+    governor.setHold(fadingFromTier >= 0);
+
+    if (fadingFromTier < 0)
+    {
+        renderTier(activeTier, buffer);
+        return;
+    }
+
+    // The new tier starts cold, so it runs silently until its FIFOs and
+    // envelopes are filled before being faded in over the old one.
+    constexpr auto warmUpLength = 2 * SpectralCompressor::fftSize;
+    constexpr auto fadeLength = SpectralCompressor::fftSize;
+
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), tierBuffer.getNumChannels());
+    auto maxBlockSize = tierBuffer.getNumSamples();
+    if (maxBlockSize == 0)
+        return;
+
+    for (int startSample = 0; startSample < numSamples; startSample += maxBlockSize)
+    {
+        auto chunkSize = juce::jmin(maxBlockSize, numSamples - startSample);
+
+        juce::AudioBuffer<float> outgoing(buffer.getArrayOfWritePointers(), numChannels, startSample, chunkSize);
+        juce::AudioBuffer<float> incoming(tierBuffer.getArrayOfWritePointers(), numChannels, 0, chunkSize);
+
+        for (auto ch = 0; ch < numChannels; ++ch)
+        {
+            incoming.copyFrom(ch, 0, outgoing, ch, 0, chunkSize);
+        }
+
+        renderTier(fadingFromTier, outgoing);
+        renderTier(activeTier, incoming);
+
+        for (auto ch = 0; ch < numChannels; ++ch)
+        {
+            auto* out = outgoing.getWritePointer(ch);
+            const auto* in = incoming.getReadPointer(ch);
+
+            for (auto i = 0; i < chunkSize; ++i)
+            {
+                auto gain = juce::jlimit(0.f, 1.f, static_cast<float>(transitionPosition + i - warmUpLength) / fadeLength);
+                out[i] += gain * (in[i] - out[i]);
+            }
+        }
+
+        transitionPosition += chunkSize;
+    }
 
-        // ..do something to the data...
+    if (transitionPosition >= warmUpLength + fadeLength)
+    {
+        fadingFromTier = -1;
     }
 }
 
+bool MultiBandCompressorAudioProcessor::isGoverned() const
+{
+    // An offline render may take as long as it needs, running slower than
+    // real time there is no reason to give up quality.
+    return qualityGovernorParam->get() && !isNonRealtime();
+}
+
+void MultiBandCompressorAudioProcessor::renderTier(int tier, juce::AudioBuffer<float>& buffer)
+{
+    switch (tier)
+    {
+        case QualityGovernor::full:
+            spectralCompressor.process(buffer);
+            break;
+
+        case QualityGovernor::reducedOverlap:
+            reducedSpectralCompressor.process(buffer);
+            break;
+
+        case QualityGovernor::iirCrossover:
+            processCrossover(buffer);
+            delayForLatency(buffer);
+            break;
+
+        default:
+            jassertfalse;
+            break;
+    }
+}
+
+void MultiBandCompressorAudioProcessor::resetTier(int tier)
+{
+    switch (tier)
+    {
+        case QualityGovernor::full:
+            spectralCompressor.reset();
+            break;
+
+        case QualityGovernor::reducedOverlap:
+            reducedSpectralCompressor.reset();
+            break;
+
+        case QualityGovernor::iirCrossover:
+            for (auto* filter : { &LP1, &AP2, &HP1, &LP2, &HP2 })
+            {
+                filter->reset();
+            }
+
+            for (auto& compressor : compressors)
+            {
+                compressor.reset();
+            }
+
+            latencyBuffer.clear();
+            latencyBufferPosition = 0;
+            break;
+
+        default:
+            jassertfalse;
+            break;
+    }
+}
+
+void MultiBandCompressorAudioProcessor::delayForLatency(juce::AudioBuffer<float>& buffer)
+{
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), latencyBuffer.getNumChannels());
+    auto delayLength = latencyBuffer.getNumSamples();
+    if (delayLength == 0)
+        return;
+
+    for (auto ch = 0; ch < numChannels; ++ch)
+    {
+        auto* data = buffer.getWritePointer(ch);
+        auto* delay = latencyBuffer.getWritePointer(ch);
+        auto position = latencyBufferPosition;
+
+        for (auto i = 0; i < numSamples; ++i)
+        {
+            std::swap(data[i], delay[position]);
+            position = (position + 1) % delayLength;
+        }
+    }
+
+    latencyBufferPosition = (latencyBufferPosition + numSamples) % delayLength;
+}
+
+//==============================================================================
+void MultiBandCompressorAudioProcessor::getDspState(juce::MemoryBlock& destData) const
+{
+    // the worker thread owns the DSP state while pipelined
+    jassert(!pipelineActive);
+
+    juce::MemoryOutputStream stream(destData, false);
+    writeDspState(stream);
+}
+
+bool MultiBandCompressorAudioProcessor::setDspState(const void* data, int sizeInBytes)
+{
+    jassert(!pipelineActive);
+    if (pipelineActive || data == nullptr || sizeInBytes <= 0)
+        return false;
+
+    // Everything is read straight into the live objects, so keep a copy to
+    // roll back to if the data turns out not to fit halfway through.
+    juce::MemoryBlock previousState;
+    getDspState(previousState);
+
+    juce::MemoryInputStream stream(data, static_cast<size_t>(sizeInBytes), false);
+    if (readDspState(stream))
+        return true;
+
+    juce::MemoryInputStream previousStream(previousState, false);
+    auto restored = readDspState(previousStream);
+    jassert(restored);
+    juce::ignoreUnused(restored);
+
+    return false;
+}
+
+void MultiBandCompressorAudioProcessor::writeDspState(juce::OutputStream& stream) const
+{
+    stream.writeInt(dspStateMagic);
+    stream.writeInt(dspStateVersion);
+    stream.writeDouble(preparedSampleRate);
+    stream.writeInt(latencyBuffer.getNumChannels());
+
+    for (auto& compressor : compressors)
+    {
+        compressor.writeState(stream);
+    }
+
+    for (auto* filter : { &LP1, &AP2, &HP1, &LP2, &HP2 })
+    {
+        filter->writeState(stream);
+    }
+
+    spectralCompressor.writeState(stream);
+    reducedSpectralCompressor.writeState(stream);
+    governor.writeState(stream);
+
+    stream.writeBool(spectralModeActive);
+    stream.writeInt(activeTier);
+    stream.writeInt(fadingFromTier);
+    stream.writeInt(transitionPosition);
+
+    stream.writeInt(latencyBufferPosition);
+    for (auto ch = 0; ch < latencyBuffer.getNumChannels(); ++ch)
+    {
+        for (auto i = 0; i < latencyBuffer.getNumSamples(); ++i)
+        {
+            stream.writeFloat(latencyBuffer.getSample(ch, i));
+        }
+    }
+}
+
+bool MultiBandCompressorAudioProcessor::readDspState(juce::InputStream& stream)
+{
+    if (stream.readInt() != dspStateMagic || stream.readInt() != dspStateVersion)
+        return false;
+
+    // filter and envelope state only mean the same thing at the same rate,
+    // written this way round so a NaN is rejected too
+    auto sampleRate = stream.readDouble();
+    if (!(std::abs(sampleRate - preparedSampleRate) < 1.0e-3) || stream.readInt() != latencyBuffer.getNumChannels())
+        return false;
+
+    for (auto& compressor : compressors)
+    {
+        if (!compressor.readState(stream))
+            return false;
+    }
+
+    for (auto* filter : { &LP1, &AP2, &HP1, &LP2, &HP2 })
+    {
+        if (!filter->readState(stream))
+            return false;
+    }
+
+    if (!spectralCompressor.readState(stream)
+        || !reducedSpectralCompressor.readState(stream)
+        || !governor.readState(stream))
+        return false;
+
+    auto newSpectralModeActive = stream.readBool();
+    auto newActiveTier = stream.readInt();
+    auto newFadingFromTier = stream.readInt();
+    auto newTransitionPosition = stream.readInt();
+    auto newLatencyBufferPosition = stream.readInt();
+
+    auto latencyBufferSize = static_cast<juce::int64>(latencyBuffer.getNumChannels()) * latencyBuffer.getNumSamples();
+
+    if (!juce::isPositiveAndBelow(newActiveTier, static_cast<int>(QualityGovernor::numTiers))
+        || newFadingFromTier < -1 || newFadingFromTier >= QualityGovernor::numTiers
+        || newTransitionPosition < 0
+        || !juce::isPositiveAndBelow(newLatencyBufferPosition, latencyBuffer.getNumSamples())
+        || stream.getNumBytesRemaining() < latencyBufferSize * static_cast<juce::int64>(sizeof(float)))
+        return false;
+
+    for (auto ch = 0; ch < latencyBuffer.getNumChannels(); ++ch)
+    {
+        for (auto i = 0; i < latencyBuffer.getNumSamples(); ++i)
+        {
+            latencyBuffer.setSample(ch, i, stream.readFloat());
+        }
+    }
+
+    latencyBufferPosition = newLatencyBufferPosition;
+    activeTier = newActiveTier;
+    publishedTier = activeTier;
+    fadingFromTier = newFadingFromTier;
+    transitionPosition = newTransitionPosition;
+
+    spectralModeActive = newSpectralModeActive;
+    updateLatency();
+
+    return true;
+}
+
 //==============================================================================
 bool MultiBandCompressorAudioProcessor::hasEditor() const
 {
@@ -361,9 +1109,22 @@ void MultiBandCompressorAudioProcessor::setStateInformation (const void* data, i
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
 
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid())
+    if (data == nullptr || sizeInBytes <= 0)
+        return;
+
+    auto tree = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+    if (tree.isValid() && tree.hasType(aptvs.state.getType()))
     {
+        // A damaged state can hold values like "nan" which the parameters
+        // would take as they are, those fall back to the default instead.
+        for (auto child : tree)
+        {
+            if (child.hasProperty("value") && !std::isfinite(static_cast<float>(child.getProperty("value"))))
+            {
+                child.removeProperty("value", nullptr);
+            }
+        }
+
         aptvs.replaceState(tree);
     }
 }
@@ -511,6 +1272,46 @@ juce::AudioProcessorValueTreeState::ParameterLayout MultiBandCompressorAudioProc
         NormalisableRange<float>(1000, 20000, 1, 1),
         2000));
 
+    layout.add(std::make_unique<AudioParameterBool>(
+        params.at(Names::spectralMode),
+        params.at(Names::spectralMode),
+        false));
+
+    layout.add(std::make_unique<AudioParameterInt>(
+        params.at(Names::spectralBandCount),
+        params.at(Names::spectralBandCount),
+        SpectralCompressor::minBands,
+        SpectralCompressor::maxBands,
+        32));
+
+    for (int band = 0; band < SpectralCompressor::maxBands; ++band)
+    {
+        layout.add(std::make_unique<AudioParameterFloat>(
+            GetSpectralBandParam(Names::spectralThresholdOffset, band),
+            GetSpectralBandParam(Names::spectralThresholdOffset, band),
+            NormalisableRange<float>(-24, 24, 0.5f, 1),
+            0));
+    }
+
+    // switching it starts or stops a thread, which hosts must not automate
+    layout.add(std::make_unique<AudioParameterBool>(
+        params.at(Names::pipelinedProcessing),
+        params.at(Names::pipelinedProcessing),
+        false,
+        AudioParameterBoolAttributes().withAutomatable(false)));
+
+    layout.add(std::make_unique<AudioParameterBool>(
+        params.at(Names::qualityGovernor),
+        params.at(Names::qualityGovernor),
+        false));
+
+    layout.add(std::make_unique<AudioParameterChoice>(
+        params.at(Names::qualityTier),
+        params.at(Names::qualityTier),
+        QualityGovernor::getTierNames(),
+        0,
+        AudioParameterChoiceAttributes().withAutomatable(false)));
+
 
     return layout;
 
@@ -9,6 +9,11 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SpectralCompressor.h"
+#include "QualityGovernor.h"
+#include "CrossoverFilter.h"
+#include "BandCompressor.h"
+#include "RealtimeSemaphore.h"
 
 
 namespace params
@@ -46,6 +51,15 @@ namespace params
         soloMidBand,
         soloHighBand,
 
+        spectralMode,
+        spectralBandCount,
+
+        spectralThresholdOffset,
+
+        qualityGovernor,
+        qualityTier,
+
+        pipelinedProcessing,
     };
 
     inline const std::map<Names, juce::String>& GetParams()
@@ -75,10 +89,22 @@ namespace params
             {soloLowBand, "Solo Low Band"},
             {soloMidBand, "Solo Mid Band"},
             {soloHighBand, "Solo High Band"},
+            {spectralMode, "Spectral Mode"},
+            {spectralBandCount, "Spectral Band Count"},
+            {spectralThresholdOffset, "Spectral Threshold Offset Band"},
+            {qualityGovernor, "Quality Governor"},
+            {qualityTier, "Quality Tier"},
+            {pipelinedProcessing, "Pipelined Processing"},
         };
         return params;
     }
 
+    // Per spectral band parameters share one entry above, numbered from 1.
+    inline juce::String GetSpectralBandParam(Names name, int band)
+    {
+        return GetParams().at(name) + " " + juce::String(band + 1);
+    }
+
     struct CompressorBand
     {
         juce::AudioParameterFloat* attack{ nullptr };
@@ -94,6 +120,21 @@ namespace params
             compressor.prepare(spec);
         }
 
+        void reset()
+        {
+            compressor.reset();
+        }
+
+        void writeState(juce::OutputStream& stream) const
+        {
+            compressor.writeState(stream);
+        }
+
+        bool readState(juce::InputStream& stream)
+        {
+            return compressor.readState(stream);
+        }
+
         void updateCompressorSettings()
         {
             compressor.setAttack(attack->get());
@@ -102,9 +143,8 @@ namespace params
             compressor.setRatio(ratio->getCurrentChoiceName().getFloatValue());
         }
 
-        void process(juce::AudioBuffer<float>& buffer)
+        void process(juce::dsp::AudioBlock<float> block)
         {
-            auto block = juce::dsp::AudioBlock<float>(buffer);
             auto context = juce::dsp::ProcessContextReplacing<float>(block);
 
             context.isBypassed = bypassed->get();
@@ -113,14 +153,16 @@ namespace params
         }
 
     private:
-        juce::dsp::Compressor<float> compressor;
+        BandCompressor compressor;
     };
 
 
     //==============================================================================
     /**
     */
-    class MultiBandCompressorAudioProcessor : public juce::AudioProcessor
+    class MultiBandCompressorAudioProcessor : public juce::AudioProcessor,
+                                              private juce::AudioProcessorValueTreeState::Listener,
+                                              private juce::AsyncUpdater
 #if JucePlugin_Enable_ARA
         , public juce::AudioProcessorARAExtension
 #endif
@@ -168,6 +210,27 @@ namespace params
 
         APTVS aptvs{ *this, nullptr, "Parameters", createParameterLayout() };
 
+        //==============================================================================
+        // Filter, envelope, FIFO and quality governor state of every DSP stage,
+        // so a render can be resumed from a known point (transport seeks, chunked
+        // offline renders) instead of starting cold. The snapshot is a plain blob
+        // that can be stored or handed to another instance prepared with the same
+        // sample rate and channel count. Parameters are not part of it, those go
+        // through get/setStateInformation as usual.
+        // Only call these between processBlock calls or while processing is suspended,
+        // and not while Pipelined Processing is on.
+        void getDspState(juce::MemoryBlock& destData) const;
+
+        // Leaves the DSP state untouched and returns false if the data is not a
+        // snapshot from a matching instance.
+        bool setDspState(const void* data, int sizeInBytes);
+
+        // Chunks played as silence because the pipeline worker was late with them.
+        int getNumPipelineOverruns() const
+        {
+            return pipelineOverruns.load(std::memory_order_relaxed);
+        }
+
     private:
         std::array<CompressorBand, 3> compressors;
         CompressorBand& lowBandCompressor = compressors[0];
@@ -175,16 +238,107 @@ namespace params
         CompressorBand& highBandCompressor = compressors[2];
 
 
-        using Filter = juce::dsp::LinkwitzRileyFilter<float>;
+        using Filter = CrossoverFilter;
         Filter  LP1, AP2,
                 HP1, LP2,
                      HP2;
 
         juce::AudioParameterFloat* lowMidCrossover{ nullptr };
         juce::AudioParameterFloat* midHighCrossover{ nullptr };
+        double preparedSampleRate{ 44100.0 };
 
         std::array<juce::AudioBuffer<float>, 3> filterBuffers;
 
+        SpectralCompressor spectralCompressor;
+        juce::AudioParameterBool* spectralModeParam{ nullptr };
+        juce::AudioParameterInt* spectralBandCountParam{ nullptr };
+        std::array<juce::AudioParameterFloat*, SpectralCompressor::maxBands> spectralThresholdOffsetParams{};
+        bool spectralModeActive{ false };
+
+        // Spectral mode only: the governor steps from spectralCompressor to the
+        // half-overlap reducedSpectralCompressor, then to the IIR crossover delayed
+        // to the same latency. Changes warm up the new tier, then crossfade.
+        // Offline renders always run the full tier.
+        SpectralCompressor reducedSpectralCompressor;
+        QualityGovernor governor;
+        juce::AudioParameterBool* qualityGovernorParam{ nullptr };
+        juce::AudioParameterChoice* qualityTierParam{ nullptr };
+
+        int activeTier{ QualityGovernor::full };
+        int fadingFromTier{ -1 };
+        int transitionPosition{ 0 };
+        juce::AudioBuffer<float> tierBuffer;
+
+        juce::AudioBuffer<float> latencyBuffer;
+        int latencyBufferPosition{ 0 };
+
+        // Opt-in: the whole chain runs on pipelineThread one block behind the host.
+        // Chunks of the prepared block size go round a ring of preallocated buffers,
+        // the audio thread counts the chunks it submitted and the worker the ones it
+        // completed. The worker sleeps on pipelineSignal, which the audio thread
+        // posts for every chunk. The thread only runs while the mode is on, and is
+        // started and stopped on the message thread.
+        struct PipelineThread : public juce::Thread
+        {
+            explicit PipelineThread(MultiBandCompressorAudioProcessor& p);
+            void run() override;
+
+            MultiBandCompressorAudioProcessor& processor;
+        };
+
+        static constexpr int numPipelineSlots = 4;
+
+        PipelineThread pipelineThread{ *this };
+        RealtimeSemaphore pipelineSignal;
+        std::atomic<juce::int64> pipelineSubmitted{ 0 };
+        std::atomic<juce::int64> pipelineCompleted{ 0 };
+        std::atomic<bool> pipelineChainBusy{ false };
+        std::atomic<int> pipelineOverruns{ 0 };
+        juce::AudioParameterBool* pipelinedParam{ nullptr };
+        bool pipelineActive{ false };
+        std::atomic<bool> isPrepared{ false };
+
+        juce::int64 pipelineTimeoutTicks{ 0 };
+
+        std::array<juce::AudioBuffer<float>, numPipelineSlots> pipelineBuffers;
+        int pipelinePosition{ 0 };
+        int pipelineOutputSlot{ -1 };
+        bool pipelineResultPending{ false };
+        bool pipelineDroppingChunk{ false };
+
+        // The chain may run on the worker, which must not call into the host.
+        // It publishes latency and tier here and processBlock passes them on.
+        std::atomic<int> publishedLatency{ 0 };
+        std::atomic<int> publishedTier{ QualityGovernor::full };
+
+        void processChain(juce::AudioBuffer<float>& buffer);
+        void processPipelined(juce::AudioBuffer<float>& buffer);
+        bool processPipelineChunks();
+        bool waitForPipelineChunks(juce::int64 numChunks, juce::int64 deadline);
+        void resetPipeline();
+        void updatePipelineThread();
+        void stopPipelineThread();
+        void updateLatency();
+        void reportToHost();
+
+        void parameterChanged(const juce::String& parameterID, float newValue) override;
+        void handleAsyncUpdate() override;
+
+        void writeDspState(juce::OutputStream& stream) const;
+        bool readDspState(juce::InputStream& stream);
+
+        void updateBandSettings();
+        void processCrossover(juce::AudioBuffer<float>& buffer);
+        void processBands(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+        void processSpectral(juce::AudioBuffer<float>& buffer);
+        bool isGoverned() const;
+        void renderTier(int tier, juce::AudioBuffer<float>& buffer);
+        void resetTier(int tier);
+        void delayForLatency(juce::AudioBuffer<float>& buffer);
+
+        // holds pipelineChainBusy to make the worker late on purpose
+        friend class PipelineTests;
+
         //==============================================================================
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultiBandCompressorAudioProcessor)
     };
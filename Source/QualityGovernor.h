@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+
+    Measures how much of the block deadline processBlock uses and asks for a
+    cheaper quality tier when the load stays too high, stepping back up only
+    after it has been comfortably low for a longer time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace params
+{
+    class QualityGovernor
+    {
+    public:
+        enum Tier
+        {
+            full,
+            reducedOverlap,
+            iirCrossover,
+
+            numTiers
+        };
+
+        static const juce::StringArray& getTierNames()
+        {
+            static juce::StringArray names{ "Full", "Reduced Overlap", "IIR Crossover" };
+            return names;
+        }
+
+        // Does nothing unless shouldMeasure is set, so blocks the governor
+        // is not in charge of leave no trace in its load history.
+        struct ScopedMeasurement
+        {
+            ScopedMeasurement(QualityGovernor& g, int n, bool shouldMeasure)
+                : governor(g), numSamples(n), isMeasuring(shouldMeasure),
+                  startTicks(shouldMeasure ? juce::Time::getHighResolutionTicks() : 0)
+            {
+            }
+
+            ~ScopedMeasurement()
+            {
+                if (isMeasuring)
+                    governor.addMeasurement(juce::Time::getHighResolutionTicks() - startTicks, numSamples);
+            }
+
+            QualityGovernor& governor;
+            int numSamples;
+            bool isMeasuring;
+            juce::int64 startTicks;
+        };
+
+        void prepare(double newSampleRate)
+        {
+            sampleRate = newSampleRate;
+            reset();
+        }
+
+        void reset()
+        {
+            tier = full;
+            hold = false;
+            smoothedLoad = 0.0;
+            overloadedSeconds = 0.0;
+            idleSeconds = 0.0;
+        }
+
+        // While a tier change is still being crossfaded the load is not
+        // representative, so the processor holds the governor until it is done.
+        void setHold(bool shouldHold)
+        {
+            hold = shouldHold;
+        }
+
+        Tier getTier() const
+        {
+            return tier;
+        }
+
+        double getLoad() const
+        {
+            return smoothedLoad;
+        }
+
+        void writeState(juce::OutputStream& stream) const
+        {
+            stream.writeInt(tier);
+            stream.writeBool(hold);
+            stream.writeDouble(smoothedLoad);
+            stream.writeDouble(overloadedSeconds);
+            stream.writeDouble(idleSeconds);
+        }
+
+        bool readState(juce::InputStream& stream)
+        {
+            auto newTier = stream.readInt();
+            auto newHold = stream.readBool();
+            auto newSmoothedLoad = stream.readDouble();
+            auto newOverloadedSeconds = stream.readDouble();
+            auto newIdleSeconds = stream.readDouble();
+
+            if (!juce::isPositiveAndBelow(newTier, static_cast<int>(numTiers))
+                || !std::isfinite(newSmoothedLoad) || !std::isfinite(newOverloadedSeconds) || !std::isfinite(newIdleSeconds))
+                return false;
+
+            tier = static_cast<Tier>(newTier);
+            hold = newHold;
+            smoothedLoad = newSmoothedLoad;
+            overloadedSeconds = newOverloadedSeconds;
+            idleSeconds = newIdleSeconds;
+            return true;
+        }
+
+    private:
+        void addMeasurement(juce::int64 elapsedTicks, int numSamples)
+        {
+            if (numSamples <= 0 || sampleRate <= 0.0)
+                return;
+
+            auto blockSeconds = numSamples / sampleRate;
+            auto load = juce::Time::highResolutionTicksToSeconds(elapsedTicks) / blockSeconds;
+
+            smoothedLoad += loadSmoothing * (load - smoothedLoad);
+
+            if (hold)
+                return;
+
+            overloadedSeconds = smoothedLoad > overloadThreshold ? overloadedSeconds + blockSeconds : 0.0;
+            idleSeconds = smoothedLoad < recoverThreshold ? idleSeconds + blockSeconds : 0.0;
+
+            if (overloadedSeconds > stepDownSeconds && tier + 1 < numTiers)
+            {
+                tier = static_cast<Tier>(tier + 1);
+                overloadedSeconds = 0.0;
+                idleSeconds = 0.0;
+            }
+            else if (idleSeconds > stepUpSeconds && tier > full)
+            {
+                tier = static_cast<Tier>(tier - 1);
+                overloadedSeconds = 0.0;
+                idleSeconds = 0.0;
+            }
+        }
+
+        static constexpr double loadSmoothing = 0.1;
+        static constexpr double overloadThreshold = 0.75;
+        static constexpr double recoverThreshold = 0.3;
+        static constexpr double stepDownSeconds = 0.25;
+        static constexpr double stepUpSeconds = 3.0;
+
+        double sampleRate{ 0.0 };
+        Tier tier{ full };
+        bool hold{ false };
+
+        double smoothedLoad{ 0.0 };
+        double overloadedSeconds{ 0.0 };
+        double idleSeconds{ 0.0 };
+    };
+}
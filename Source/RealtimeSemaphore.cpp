@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    RealtimeSemaphore.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSemaphore.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <mach/mach.h>
+#else
+ #include <semaphore.h>
+ #include <cerrno>
+#endif
+
+using namespace params;
+
+#if JUCE_WINDOWS
+
+struct RealtimeSemaphore::Pimpl
+{
+    Pimpl() : handle(CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr))
+    {
+        jassert(handle != nullptr);
+    }
+
+    ~Pimpl()
+    {
+        CloseHandle(handle);
+    }
+
+    void signal() noexcept
+    {
+        ReleaseSemaphore(handle, 1, nullptr);
+    }
+
+    void wait() noexcept
+    {
+        WaitForSingleObject(handle, INFINITE);
+    }
+
+    HANDLE handle;
+};
+
+#elif JUCE_MAC || JUCE_IOS
+
+// Mach semaphores rather than POSIX ones, sem_init() is not implemented on Apple platforms.
+struct RealtimeSemaphore::Pimpl
+{
+    Pimpl()
+    {
+        auto result = semaphore_create(mach_task_self(), &semaphore, SYNC_POLICY_FIFO, 0);
+        jassertquiet(result == KERN_SUCCESS);
+    }
+
+    ~Pimpl()
+    {
+        semaphore_destroy(mach_task_self(), semaphore);
+    }
+
+    void signal() noexcept
+    {
+        semaphore_signal(semaphore);
+    }
+
+    void wait() noexcept
+    {
+        while (semaphore_wait(semaphore) == KERN_ABORTED) {}
+    }
+
+    semaphore_t semaphore{};
+};
+
+#else
+
+struct RealtimeSemaphore::Pimpl
+{
+    Pimpl()
+    {
+        auto result = sem_init(&semaphore, 0, 0);
+        jassertquiet(result == 0);
+    }
+
+    ~Pimpl()
+    {
+        sem_destroy(&semaphore);
+    }
+
+    void signal() noexcept
+    {
+        sem_post(&semaphore);
+    }
+
+    void wait() noexcept
+    {
+        while (sem_wait(&semaphore) != 0 && errno == EINTR) {}
+    }
+
+    sem_t semaphore{};
+};
+
+#endif
+
+//==============================================================================
+RealtimeSemaphore::RealtimeSemaphore() : pimpl(std::make_unique<Pimpl>())
+{
+}
+
+RealtimeSemaphore::~RealtimeSemaphore() = default;
+
+void RealtimeSemaphore::signal() noexcept
+{
+    pimpl->signal();
+}
+
+void RealtimeSemaphore::wait() noexcept
+{
+    pimpl->wait();
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    RealtimeSemaphore.h
+
+    Counting semaphore whose signal() may be called from the audio thread: it
+    never blocks or allocates, unlike juce::WaitableEvent, which takes a lock.
+    Wraps the native OS semaphore, so a thread in wait() really sleeps.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace params
+{
+    class RealtimeSemaphore
+    {
+    public:
+        RealtimeSemaphore();
+        ~RealtimeSemaphore();
+
+        // Wakes one waiting thread, or lets the next wait() return at once.
+        void signal() noexcept;
+
+        // Sleeps until signal() has been called more often than wait() returned.
+        void wait() noexcept;
+
+    private:
+        struct Pimpl;
+        std::unique_ptr<Pimpl> pimpl;
+
+        JUCE_DECLARE_NON_COPYABLE(RealtimeSemaphore)
+    };
+}
@@ -0,0 +1,345 @@
+/*
+  ==============================================================================
+
+    SpectralCompressor.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralCompressor.h"
+
+using namespace params;
+
+namespace
+{
+    constexpr float lowestBandFreq = 20.f;
+
+    // Same one-pole coefficient as juce::dsp::BallisticsFilter, but stepped
+    // once per hop instead of once per sample.
+    float ballisticsCoefficient(float timeMs, double sampleRate, int hopSize)
+    {
+        if (timeMs < 1.0e-3f)
+            return 0.f;
+
+        auto expFactor = -2.0 * juce::MathConstants<double>::pi * 1000.0 * hopSize / sampleRate;
+        return static_cast<float>(std::exp(expFactor / timeMs));
+    }
+}
+
+//==============================================================================
+SpectralCompressor::SpectralCompressor()
+{
+    window.resize(fftSize);
+    fftData.resize(2 * fftSize);
+    binGain.resize(numBins);
+    binBand.resize(numBins);
+    binFrac.resize(numBins);
+
+    // sqrt-Hann for both analysis and synthesis, their product is a Hann window
+    // which overlap-adds to a constant at both 50% and 75% overlap.
+    for (size_t n = 0; n < window.size(); ++n)
+    {
+        auto hann = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * static_cast<float>(n) / fftSize);
+        window[n] = std::sqrt(hann);
+        sumOfSquares += hann;
+    }
+
+    // Parseval: sum |X_k|^2 == N * sum (x w)^2, so this maps band energy to mean square.
+    windowNormalisation = 1.f / (fftSize * sumOfSquares);
+    overlapScale = hopSize / sumOfSquares;
+
+    bandGain.fill(1.f);
+}
+
+void SpectralCompressor::setHopSize(int newHopSize)
+{
+    jassert(newHopSize == fftSize / 4 || newHopSize == fftSize / 2);
+
+    hopSize = newHopSize;
+    overlapScale = hopSize / sumOfSquares;
+}
+
+void SpectralCompressor::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+
+    channels.resize(spec.numChannels);
+    for (auto& state : channels)
+    {
+        state.inputFifo.assign(fftSize, 0.f);
+        state.outputFifo.assign(fftSize, 0.f);
+        state.envelope.assign(maxBands, 0.f);
+    }
+
+    updateBandLayout();
+    setRegions(regions);
+    reset();
+}
+
+void SpectralCompressor::reset()
+{
+    for (auto& state : channels)
+    {
+        std::fill(state.inputFifo.begin(), state.inputFifo.end(), 0.f);
+        std::fill(state.outputFifo.begin(), state.outputFifo.end(), 0.f);
+        std::fill(state.envelope.begin(), state.envelope.end(), 0.f);
+        state.fifoPos = 0;
+        state.hopCount = 0;
+    }
+}
+
+void SpectralCompressor::writeState(juce::OutputStream& stream) const
+{
+    stream.writeInt(numBands);
+    stream.writeInt(static_cast<int>(channels.size()));
+
+    for (const auto& state : channels)
+    {
+        stream.writeInt(state.fifoPos);
+        stream.writeInt(state.hopCount);
+
+        for (const auto* values : { &state.inputFifo, &state.outputFifo, &state.envelope })
+        {
+            for (auto value : *values)
+                stream.writeFloat(value);
+        }
+    }
+}
+
+bool SpectralCompressor::readState(juce::InputStream& stream)
+{
+    auto newNumBands = stream.readInt();
+    auto numChannels = stream.readInt();
+    if (newNumBands < minBands || newNumBands > maxBands || numChannels != static_cast<int>(channels.size()))
+        return false;
+
+    constexpr auto channelStateSize = 2 * sizeof(int) + (2 * fftSize + maxBands) * sizeof(float);
+    if (stream.getNumBytesRemaining() < static_cast<juce::int64>(channels.size() * channelStateSize))
+        return false;
+
+    // Applied here rather than left to the next setNumBands() from the
+    // parameter, which would clear the envelopes read below.
+    if (newNumBands != numBands)
+    {
+        numBands = newNumBands;
+        updateBandLayout();
+    }
+
+    for (auto& state : channels)
+    {
+        auto fifoPos = stream.readInt();
+        auto hopCount = stream.readInt();
+
+        if (!juce::isPositiveAndBelow(fifoPos, fftSize) || !juce::isPositiveAndBelow(hopCount, hopSize))
+            return false;
+
+        state.fifoPos = fifoPos;
+        state.hopCount = hopCount;
+
+        for (auto* values : { &state.inputFifo, &state.outputFifo, &state.envelope })
+        {
+            for (auto& value : *values)
+                value = stream.readFloat();
+        }
+    }
+
+    return true;
+}
+
+void SpectralCompressor::setNumBands(int newNumBands)
+{
+    newNumBands = juce::jlimit(minBands, maxBands, newNumBands);
+    if (newNumBands == numBands)
+        return;
+
+    numBands = newNumBands;
+    updateBandLayout();
+
+    // band boundaries moved, so the old envelopes no longer describe the same bins
+    for (auto& state : channels)
+        std::fill(state.envelope.begin(), state.envelope.end(), 0.f);
+}
+
+void SpectralCompressor::setCrossovers(float lowMidFreq, float midHighFreq)
+{
+    // one comparison per band, cheap enough to redo every block
+    lowMidCrossover = lowMidFreq;
+    midHighCrossover = midHighFreq;
+    updateBandRegions();
+}
+
+void SpectralCompressor::setRegions(const std::array<SpectralRegion, 3>& newRegions)
+{
+    regions = newRegions;
+
+    for (size_t r = 0; r < regions.size(); ++r)
+    {
+        attackCoeff[r] = ballisticsCoefficient(regions[r].attack, sampleRate, hopSize);
+        releaseCoeff[r] = ballisticsCoefficient(regions[r].release, sampleRate, hopSize);
+    }
+}
+
+void SpectralCompressor::setBandThresholdOffsets(const std::array<float, maxBands>& newOffsets)
+{
+    bandThresholdOffset = newOffsets;
+}
+
+//==============================================================================
+void SpectralCompressor::updateBandLayout()
+{
+    const auto binWidth = static_cast<float>(sampleRate / fftSize);
+    const auto nyquist = static_cast<float>(sampleRate * 0.5);
+    const auto lastBand = static_cast<size_t>(numBands) - 1;
+
+    bandEdges[0] = 0;
+    bandEdges[lastBand + 1] = numBins;
+
+    for (size_t b = 1; b <= lastBand; ++b)
+    {
+        auto freq = lowestBandFreq * std::pow(nyquist / lowestBandFreq, static_cast<float>(b) / numBands);
+        auto bin = juce::roundToInt(freq / binWidth);
+
+        // every band needs at least one bin, the bottom octaves are narrower than that
+        bandEdges[b] = juce::jlimit(bandEdges[b - 1] + 1, numBins - static_cast<int>(lastBand + 1 - b), bin);
+    }
+
+    for (size_t b = 0; b <= lastBand; ++b)
+        bandCentreBin[b] = 0.5f * static_cast<float>(bandEdges[b] + bandEdges[b + 1] - 1);
+
+    // A bin's gain is interpolated from the two band centres around it, so each
+    // band measures everything from the previous centre to the next one. That
+    // way a tone between two centres is seen at full level by both gains it uses.
+    for (size_t b = 0; b <= lastBand; ++b)
+    {
+        detectionStart[b] = b == 0 ? 0 : static_cast<int>(std::ceil(bandCentreBin[b - 1]));
+        detectionEnd[b] = b == lastBand ? numBins : static_cast<int>(std::floor(bandCentreBin[b + 1])) + 1;
+    }
+
+    // Each bin interpolates between the gains of the two nearest band centres
+    // so the mask has no steps at band edges.
+    size_t b = 0;
+    for (size_t k = 0; k < binBand.size(); ++k)
+    {
+        auto bin = static_cast<float>(k);
+        while (b + 1 < lastBand && bin >= bandCentreBin[b + 1])
+            ++b;
+
+        binBand[k] = static_cast<int>(b);
+        binFrac[k] = juce::jlimit(0.f, 1.f, (bin - bandCentreBin[b]) / (bandCentreBin[b + 1] - bandCentreBin[b]));
+    }
+
+    updateBandRegions();
+}
+
+void SpectralCompressor::updateBandRegions()
+{
+    const auto binWidth = static_cast<float>(sampleRate / fftSize);
+
+    for (size_t b = 0; b < static_cast<size_t>(numBands); ++b)
+    {
+        auto centreFreq = bandCentreBin[b] * binWidth;
+        bandRegion[b] = centreFreq < lowMidCrossover ? 0 : (centreFreq < midHighCrossover ? 1 : 2);
+    }
+}
+
+//==============================================================================
+void SpectralCompressor::process(juce::AudioBuffer<float>& buffer)
+{
+    auto numChannels = juce::jmin(buffer.getNumChannels(), static_cast<int>(channels.size()));
+    auto numSamples = buffer.getNumSamples();
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto& state = channels[static_cast<size_t>(ch)];
+        auto* data = buffer.getWritePointer(ch);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto pos = static_cast<size_t>(state.fifoPos);
+
+            state.inputFifo[pos] = data[i];
+            data[i] = state.outputFifo[pos];
+            state.outputFifo[pos] = 0.f;
+
+            state.fifoPos = (state.fifoPos + 1) & (fftSize - 1);
+
+            if (++state.hopCount == hopSize)
+            {
+                state.hopCount = 0;
+                processFrame(state);
+            }
+        }
+    }
+}
+
+void SpectralCompressor::processFrame(ChannelState& state)
+{
+    // fifoPos points at the oldest sample, so the frame unwraps from there
+    const auto start = static_cast<size_t>(state.fifoPos);
+    constexpr auto fifoMask = static_cast<size_t>(fftSize - 1);
+
+    for (size_t n = 0; n < window.size(); ++n)
+        fftData[n] = state.inputFifo[(start + n) & fifoMask] * window[n];
+
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.f);
+
+    fft.performRealOnlyForwardTransform(fftData.data());
+
+    for (size_t b = 0; b < static_cast<size_t>(numBands); ++b)
+    {
+        auto energy = 0.f;
+        for (auto k = static_cast<size_t>(detectionStart[b]); k < static_cast<size_t>(detectionEnd[b]); ++k)
+        {
+            auto re = fftData[2 * k];
+            auto im = fftData[2 * k + 1];
+            auto weight = (k == 0 || k == fftSize / 2) ? 1.f : 2.f;
+            energy += weight * (re * re + im * im);
+        }
+
+        // peak level of a sine with the same mean square, to match the
+        // peak detector juce::dsp::Compressor uses
+        auto level = std::sqrt(2.f * energy * windowNormalisation);
+
+        const auto r = static_cast<size_t>(bandRegion[b]);
+        const auto& region = regions[r];
+        auto gain = 1.f;
+
+        if (!region.bypassed)
+        {
+            auto& env = state.envelope[b];
+            auto cte = level > env ? attackCoeff[r] : releaseCoeff[r];
+            env = level + cte * (env - level);
+
+            auto thresholdGain = juce::Decibels::decibelsToGain(region.threshold + bandThresholdOffset[b], -200.f);
+            if (env >= thresholdGain)
+                gain = std::pow(env / thresholdGain, 1.f / region.ratio - 1.f);
+        }
+
+        bandGain[b] = region.audible ? gain : 0.f;
+    }
+
+    for (size_t k = 0; k < binGain.size(); ++k)
+    {
+        auto band = static_cast<size_t>(binBand[k]);
+        auto lower = bandGain[band];
+        auto upper = bandGain[band + 1];
+        binGain[k] = lower + binFrac[k] * (upper - lower);
+    }
+
+    for (size_t k = 0; k < binGain.size(); ++k)
+    {
+        fftData[2 * k] *= binGain[k];
+        fftData[2 * k + 1] *= binGain[k];
+
+        if (k != 0 && k != fftSize / 2)
+        {
+            fftData[2 * (fftSize - k)] *= binGain[k];
+            fftData[2 * (fftSize - k) + 1] *= binGain[k];
+        }
+    }
+
+    fft.performRealOnlyInverseTransform(fftData.data());
+
+    for (size_t n = 0; n < window.size(); ++n)
+        state.outputFifo[(start + n) & fifoMask] += fftData[n] * window[n] * overlapScale;
+}
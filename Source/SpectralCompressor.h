@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    SpectralCompressor.h
+
+    STFT based multiband engine. Bins are grouped into 8-64 log spaced bands,
+    each band runs its own envelope follower with the same threshold / attack /
+    release / ratio semantics as juce::dsp::Compressor, and the resulting
+    per-band gains are applied as an interpolated spectral mask. There is one
+    forward and one inverse FFT per hop regardless of the band count.
+
+    Gains are only updated once per hop and crossfaded by the overlapping
+    windows, so attack and release times shorter than a hop (about 12 ms at
+    44.1 kHz) behave as if they were one hop long.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+namespace params
+{
+    // Settings of one of the three crossover regions (low / mid / high).
+    // Every spectral band whose centre falls into a region uses its settings,
+    // with the band's own threshold offset added on top.
+    struct SpectralRegion
+    {
+        float threshold{ 0.f };     // dB
+        float attack{ 50.f };       // ms
+        float release{ 250.f };     // ms
+        float ratio{ 1.f };
+        bool bypassed{ false };
+        bool audible{ true };       // false when muted, or not soloed while another region is
+    };
+
+    class SpectralCompressor
+    {
+    public:
+        static constexpr int fftOrder = 11;
+        static constexpr int fftSize = 1 << fftOrder;
+        static constexpr int numBins = fftSize / 2 + 1;
+
+        static constexpr int minBands = 8;
+        static constexpr int maxBands = 64;
+
+        SpectralCompressor();
+
+        // fftSize / 4 (75% overlap) by default, fftSize / 2 halves the FFT work.
+        // Must be called before prepare().
+        void setHopSize(int newHopSize);
+
+        void prepare(const juce::dsp::ProcessSpec& spec);
+        void reset();
+
+        void setNumBands(int newNumBands);
+        void setCrossovers(float lowMidFreq, float midHighFreq);
+        void setRegions(const std::array<SpectralRegion, 3>& newRegions);
+
+        // dB added to the region threshold, indexed from the lowest band up
+        void setBandThresholdOffsets(const std::array<float, maxBands>& newOffsets);
+
+        void process(juce::AudioBuffer<float>& buffer);
+
+        static constexpr int getLatencyInSamples() { return fftSize; }
+
+        // Everything that carries over from one block to the next, including
+        // the band count the envelopes belong to. Band settings are not
+        // included, they are rebuilt from the parameters.
+        void writeState(juce::OutputStream& stream) const;
+
+        // Fails if the state was written by an engine with another channel count.
+        bool readState(juce::InputStream& stream);
+
+    private:
+        struct ChannelState
+        {
+            std::vector<float> inputFifo;
+            std::vector<float> outputFifo;
+            std::vector<float> envelope;
+            int fifoPos{ 0 };
+            int hopCount{ 0 };
+        };
+
+        void updateBandLayout();
+        void updateBandRegions();
+        void processFrame(ChannelState& state);
+
+        juce::dsp::FFT fft{ fftOrder };
+
+        std::vector<ChannelState> channels;
+
+        std::vector<float> window;
+        std::vector<float> fftData;
+        std::vector<float> binGain;
+
+        std::array<int, maxBands + 1> bandEdges{};
+        std::array<float, maxBands> bandCentreBin{};
+        std::array<int, maxBands> detectionStart{};
+        std::array<int, maxBands> detectionEnd{};
+        std::array<int, maxBands> bandRegion{};
+        std::array<float, maxBands> bandGain{};
+        std::array<float, maxBands> bandThresholdOffset{};
+
+        std::vector<int> binBand;
+        std::vector<float> binFrac;
+
+        std::array<SpectralRegion, 3> regions;
+        std::array<float, 3> attackCoeff{};
+        std::array<float, 3> releaseCoeff{};
+
+        double sampleRate{ 44100.0 };
+        int hopSize{ fftSize / 4 };
+        float sumOfSquares{ 0.f };
+        float windowNormalisation{ 1.f };
+        float overlapScale{ 1.f };
+
+        int numBands{ 32 };
+        float lowMidCrossover{ 400.f };
+        float midHighCrossover{ 2000.f };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectralCompressor)
+    };
+}
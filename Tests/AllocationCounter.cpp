@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.cpp
+
+    juce::HeapBlock, and with it juce::AudioBuffer, allocates with std::malloc
+    and friends rather than operator new. On Linux those are replaced here
+    and forward to glibc's own implementation, so both paths are counted.
+    Sanitizer builds bring their own allocator, there only operator new is.
+
+  ==============================================================================
+*/
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+ #define MBC_SANITIZER_ALLOCATOR 1
+#elif defined(__has_feature)
+ #if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+  #define MBC_SANITIZER_ALLOCATOR 1
+ #endif
+#endif
+
+#if defined(__linux__) && defined(__GLIBC__) && !defined(MBC_SANITIZER_ALLOCATOR)
+ #define MBC_COUNT_MALLOC 1
+#else
+ #define MBC_COUNT_MALLOC 0
+#endif
+
+namespace
+{
+    std::atomic<int> numAllocations{ 0 };
+    std::atomic<int> numDeallocations{ 0 };
+
+    void countAllocation()
+    {
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void countDeallocation(void* ptr)
+    {
+        if (ptr != nullptr)
+            numDeallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // with malloc replaced below operator new is counted on its way through it
+    void* allocate(std::size_t size) noexcept
+    {
+       #if ! MBC_COUNT_MALLOC
+        countAllocation();
+       #endif
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void deallocate(void* ptr) noexcept
+    {
+       #if ! MBC_COUNT_MALLOC
+        countDeallocation(ptr);
+       #endif
+        std::free(ptr);
+    }
+}
+
+int params::getNumAllocations()
+{
+    return numAllocations.load(std::memory_order_relaxed);
+}
+
+int params::getNumDeallocations()
+{
+    return numDeallocations.load(std::memory_order_relaxed);
+}
+
+bool params::canCountMalloc()
+{
+    return MBC_COUNT_MALLOC != 0;
+}
+
+#if MBC_COUNT_MALLOC
+// glibc's allocator under its internal names
+extern "C"
+{
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+    void* __libc_realloc(void*, std::size_t);
+    void* __libc_memalign(std::size_t, std::size_t);
+    void __libc_free(void*);
+}
+
+extern "C"
+{
+    void* malloc(std::size_t size) noexcept
+    {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t numElements, std::size_t elementSize) noexcept
+    {
+        countAllocation();
+        return __libc_calloc(numElements, elementSize);
+    }
+
+    void* realloc(void* ptr, std::size_t size) noexcept
+    {
+        countAllocation();
+        return __libc_realloc(ptr, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    {
+        countAllocation();
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, std::size_t alignment, std::size_t size) noexcept
+    {
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        countAllocation();
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr != nullptr ? 0 : ENOMEM;
+    }
+
+    void free(void* ptr) noexcept
+    {
+        countDeallocation(ptr);
+        __libc_free(ptr);
+    }
+}
+#endif
+
+void* operator new(std::size_t size)
+{
+    if (auto* ptr = allocate(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept                                { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept                              { deallocate(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept                   { deallocate(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept                 { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept         { deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept       { deallocate(ptr); }
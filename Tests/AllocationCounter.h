@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+
+    AllocationCounter.h
+
+    The test app replaces the global operator new, and on Linux malloc,
+    calloc, realloc and free as well, so tests can check that the audio
+    thread (and the pipeline worker) never touch the heap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+
+namespace params
+{
+    // Number of heap allocations so far, from any thread.
+    int getNumAllocations();
+
+    // Number of blocks handed back to the heap so far, from any thread.
+    int getNumDeallocations();
+
+    // False where only operator new can be counted, then anything that goes
+    // straight to malloc (juce::HeapBlock, so every AudioBuffer) is missed.
+    bool canCountMalloc();
+}
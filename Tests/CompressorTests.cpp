@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    CompressorTests.cpp
+
+    Static curves: a steady sine in the mid band settles at
+    threshold + (level - threshold) / ratio above the threshold and passes
+    unchanged below it, in both the crossover and the spectral engine.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class CompressorTests : public juce::UnitTest
+    {
+    public:
+        CompressorTests() : juce::UnitTest("Compressor", testCategory) {}
+
+        void runTest() override
+        {
+            // The per-sample peak detector sags a little between the peaks of
+            // the waveform, which costs a few tenths of a dB of gain reduction.
+            beginTest("Crossover mode static curve");
+            {
+                checkStaticCurve(false, 0.5f);
+            }
+
+            beginTest("Spectral mode static curve");
+            {
+                checkStaticCurve(true, 0.25f);
+            }
+
+            beginTest("Bypassed band passes signal above the threshold unchanged");
+            {
+                for (auto spectral : { false, true })
+                {
+                    ProcessorHarness harness;
+                    setUpMidBand(harness, spectral, -30.f, 10.f);
+                    harness.set(Names::bypassedMidBand, 1.f);
+
+                    expectWithinAbsoluteError(measureLevel(harness, -6.f), -6.f, 0.1f,
+                                              spectral ? "spectral" : "crossover");
+                }
+            }
+
+            beginTest("Spectral threshold offsets add to the region threshold");
+            {
+                ProcessorHarness offset;
+                setUpMidBand(offset, true, -30.f, 4.f);
+                for (int band = 0; band < SpectralCompressor::maxBands; ++band)
+                    offset.set(GetSpectralBandParam(Names::spectralThresholdOffset, band), 12.f);
+
+                ProcessorHarness plain;
+                setUpMidBand(plain, true, -18.f, 4.f);
+
+                expectWithinAbsoluteError(measureLevel(offset, -6.f), measureLevel(plain, -6.f), 0.01f);
+
+                // lowering only the bands far away from the sine changes nothing
+                ProcessorHarness unrelated;
+                setUpMidBand(unrelated, true, -18.f, 4.f);
+                for (int band = 0; band < 4; ++band)
+                    unrelated.set(GetSpectralBandParam(Names::spectralThresholdOffset, band), -24.f);
+
+                expectWithinAbsoluteError(measureLevel(unrelated, -6.f), measureLevel(plain, -6.f), 0.01f);
+            }
+        }
+
+    private:
+        static constexpr float sineFrequency = 1000.f;
+
+        void setUpMidBand(ProcessorHarness& harness, bool spectral, float threshold, float ratio)
+        {
+            harness.set(Names::spectralMode, spectral ? 1.f : 0.f);
+            harness.set(Names::lowMidCrossoverFreq, 200.f);
+            harness.set(Names::midHighCrossoverFreq, 8000.f);
+
+            harness.setAllBands(Names::thresholdLowBand, threshold);
+            harness.setAllBands(Names::attackLowBand, 5.f);
+            harness.setAllBands(Names::releaseLowBand, 500.f);
+            harness.setAllRatios(ratio);
+        }
+
+        // Output peak of a steady sine once the envelope has settled, in dB.
+        float measureLevel(ProcessorHarness& harness, float inputLevel)
+        {
+            auto amplitude = juce::Decibels::decibelsToGain(inputLevel);
+            auto buffer = makeSine(2, 48000, harness.sampleRate, sineFrequency, amplitude);
+            harness.render(buffer);
+
+            return sineLevelDecibels(buffer, 36000);
+        }
+
+        void checkStaticCurve(bool spectral, float tolerance)
+        {
+            constexpr auto threshold = -20.f;
+
+            for (auto ratio : { 2.f, 4.f, 10.f })
+            {
+                for (auto inputLevel : { -40.f, -30.f, -20.f, -12.f, -6.f, 0.f })
+                {
+                    ProcessorHarness harness;
+                    setUpMidBand(harness, spectral, threshold, ratio);
+
+                    auto expected = inputLevel > threshold ? threshold + (inputLevel - threshold) / ratio
+                                                           : inputLevel;
+
+                    expectWithinAbsoluteError(measureLevel(harness, inputLevel), expected, tolerance,
+                                              "ratio " + juce::String(ratio) + ", input " + juce::String(inputLevel) + " dB");
+                }
+            }
+        }
+    };
+
+    static CompressorTests compressorTests;
+}
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    CrossoverTests.cpp
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class CrossoverTests : public juce::UnitTest
+    {
+    public:
+        CrossoverTests() : juce::UnitTest("Crossover", testCategory) {}
+
+        void runTest() override
+        {
+            beginTest("Band sum with bypassed compressors is the all-pass of both crossovers");
+            {
+                for (auto sampleRate : { 44100.0, 48000.0, 96000.0 })
+                {
+                    for (auto crossovers : { std::pair<float, float>{ 20.f, 1000.f },
+                                             std::pair<float, float>{ 400.f, 2000.f },
+                                             std::pair<float, float>{ 999.f, 20000.f } })
+                    {
+                        checkReconstruction(sampleRate, crossovers.first, crossovers.second);
+                    }
+                }
+            }
+
+            // AP2 / LP2 / HP2 used to be tuned to the midHighCrossoverFreq enum
+            // value, i.e. 1 Hz, which silenced the mid band and let everything
+            // above the low band through the high band.
+            beginTest("Mid/high split follows the Mid-High Crossover parameter");
+            {
+                for (auto midHighFreq : { 2000.f, 4000.f, 8000.f })
+                {
+                    auto below = midHighFreq / 4.f;
+                    auto above = midHighFreq * 2.5f;
+
+                    expectWithinAbsoluteError(soloedLevel(Names::soloMidBand, midHighFreq, below), 0.f, 1.f,
+                                              "mid band passes " + juce::String(below));
+                    expectLessThan(soloedLevel(Names::soloMidBand, midHighFreq, above), -20.f,
+                                   "mid band rejects " + juce::String(above));
+                    expectWithinAbsoluteError(soloedLevel(Names::soloHighBand, midHighFreq, above), 0.f, 1.f,
+                                              "high band passes " + juce::String(above));
+                    expectLessThan(soloedLevel(Names::soloHighBand, midHighFreq, below), -20.f,
+                                   "high band rejects " + juce::String(below));
+                }
+            }
+        }
+
+    private:
+        void checkReconstruction(double sampleRate, float lowMidFreq, float midHighFreq)
+        {
+            ProcessorHarness harness(sampleRate, 512);
+            harness.setAllBands(Names::bypassedLowBand, 1.f);
+            harness.set(Names::lowMidCrossoverFreq, lowMidFreq);
+            harness.set(Names::midHighCrossoverFreq, midHighFreq);
+
+            auto input = makeNoise(2, 16384, 0.5f);
+            auto output = input;
+            harness.render(output);
+
+            juce::dsp::ProcessSpec spec{ sampleRate, 512, 2 };
+            juce::dsp::LinkwitzRileyFilter<float> lowMidAllpass, midHighAllpass;
+
+            for (auto* filter : { &lowMidAllpass, &midHighAllpass })
+            {
+                filter->setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+                filter->prepare(spec);
+            }
+
+            lowMidAllpass.setCutoffFrequency(lowMidFreq);
+            midHighAllpass.setCutoffFrequency(midHighFreq);
+
+            auto reference = input;
+            juce::dsp::AudioBlock<float> block(reference);
+            juce::dsp::ProcessContextReplacing<float> context(block);
+            lowMidAllpass.process(context);
+            midHighAllpass.process(context);
+
+            expectLessThan(maxAbsDifference(output, reference), 1.0e-4f,
+                           juce::String(sampleRate) + " Hz, crossovers " + juce::String(lowMidFreq) + " / " + juce::String(midHighFreq));
+        }
+
+        // Steady state level of a full scale sine with only one band soloed, in dB.
+        float soloedLevel(Names solo, float midHighFreq, float sineFreq)
+        {
+            ProcessorHarness harness(48000.0, 512);
+            harness.setAllBands(Names::bypassedLowBand, 1.f);
+            harness.set(Names::lowMidCrossoverFreq, 200.f);
+            harness.set(Names::midHighCrossoverFreq, midHighFreq);
+            harness.set(solo, 1.f);
+
+            auto buffer = makeSine(2, 24000, harness.sampleRate, sineFreq, 1.f);
+            harness.render(buffer);
+
+            return sineLevelDecibels(buffer, 12000);
+        }
+    };
+
+    static CrossoverTests crossoverTests;
+}
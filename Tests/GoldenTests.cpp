@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    GoldenTests.cpp
+
+    Renders a fixed input through a handful of settings and compares the
+    result with the renders stored in Tests/Golden. After an intentional
+    change to the sound, run once with MBC_UPDATE_GOLDEN=1 to rewrite them
+    and commit the new files together with the change.
+
+    Apart from juce::dsp::FFT, every stage in these renders is plain scalar
+    code that gives the same result everywhere. The FFT backends (fallback,
+    vDSP, IPP, FFTW) round differently and move the spectral renders by a
+    few 1e-6. The tolerance leaves room for that, and no more.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class GoldenTests : public juce::UnitTest
+    {
+    public:
+        GoldenTests() : juce::UnitTest("Golden Renders", testCategory) {}
+
+        void runTest() override
+        {
+            auto update = juce::SystemStats::getEnvironmentVariable("MBC_UPDATE_GOLDEN", {}) == "1";
+
+            for (const auto& config : getConfigs())
+            {
+                beginTest(config.name);
+
+                ProcessorHarness harness(48000.0, 480);
+                config.setUp(harness);
+
+                auto buffer = makeInput();
+                harness.render(buffer);
+
+                auto file = juce::File(MBC_GOLDEN_DIR).getChildFile(config.name + ".f32");
+
+                if (update)
+                {
+                    expect(write(file, buffer), "could not write " + file.getFullPathName());
+                    logMessage("Updated " + file.getFullPathName());
+                    continue;
+                }
+
+                juce::AudioBuffer<float> golden;
+                if (!read(file, golden))
+                {
+                    expect(false, "missing or malformed " + file.getFullPathName());
+                    continue;
+                }
+
+                expectLessThan(maxAbsDifference(buffer, golden), 1.0e-4f);
+            }
+        }
+
+    private:
+        static constexpr int numChannels = 2;
+        static constexpr int numSamples = 8192;
+
+        struct Config
+        {
+            juce::String name;
+            std::function<void(ProcessorHarness&)> setUp;
+        };
+
+        static void setUpCompression(ProcessorHarness& harness)
+        {
+            harness.set(Names::lowMidCrossoverFreq, 250.f);
+            harness.set(Names::midHighCrossoverFreq, 4000.f);
+            harness.setAllBands(Names::thresholdLowBand, -24.f);
+            harness.setAllBands(Names::attackLowBand, 10.f);
+            harness.setAllBands(Names::releaseLowBand, 100.f);
+            harness.setAllRatios(4.f);
+        }
+
+        static std::vector<Config> getConfigs()
+        {
+            return
+            {
+                { "crossover", [](ProcessorHarness& harness)
+                    {
+                        setUpCompression(harness);
+                    } },
+
+                { "crossover_mute_mid", [](ProcessorHarness& harness)
+                    {
+                        setUpCompression(harness);
+                        harness.set(Names::muteMidBand, 1.f);
+                    } },
+
+                { "spectral_32_bands", [](ProcessorHarness& harness)
+                    {
+                        setUpCompression(harness);
+                        harness.set(Names::spectralMode, 1.f);
+                        harness.set(Names::spectralBandCount, 32.f);
+                    } },
+
+                { "spectral_13_bands_offsets", [](ProcessorHarness& harness)
+                    {
+                        setUpCompression(harness);
+                        harness.set(Names::spectralMode, 1.f);
+                        harness.set(Names::spectralBandCount, 13.f);
+                        harness.setAllRatios(3.f);
+
+                        for (int band = 0; band < 13; ++band)
+                            harness.set(GetSpectralBandParam(Names::spectralThresholdOffset, band), -6.f + band);
+                    } },
+            };
+        }
+
+        // Noise with a slow level swing on top of a low sine, different noise per channel.
+        static juce::AudioBuffer<float> makeInput()
+        {
+            juce::AudioBuffer<float> buffer(numChannels, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                TestNoise noise(static_cast<juce::uint32>(ch + 1));
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    auto phase = juce::MathConstants<double>::twoPi * i / 48000.0;
+                    auto swing = 0.1f + 0.9f * static_cast<float>(std::abs(std::sin(20.0 * phase)));
+                    auto sine = 0.3f * static_cast<float>(std::sin(220.0 * phase));
+
+                    buffer.setSample(ch, i, swing * 0.5f * noise.next() + sine);
+                }
+            }
+
+            return buffer;
+        }
+
+        // Raw little endian float32, one channel after the other.
+        static bool write(const juce::File& file, const juce::AudioBuffer<float>& buffer)
+        {
+            juce::MemoryBlock data;
+            {
+                juce::MemoryOutputStream stream(data, false);
+
+                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                    for (int i = 0; i < buffer.getNumSamples(); ++i)
+                        stream.writeFloat(buffer.getSample(ch, i));
+            }
+
+            return file.replaceWithData(data.getData(), data.getSize());
+        }
+
+        static bool read(const juce::File& file, juce::AudioBuffer<float>& buffer)
+        {
+            juce::MemoryBlock data;
+            if (!file.loadFileAsData(data) || data.getSize() != sizeof(float) * numChannels * numSamples)
+                return false;
+
+            juce::MemoryInputStream stream(data, false);
+            buffer.setSize(numChannels, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                for (int i = 0; i < numSamples; ++i)
+                    buffer.setSample(ch, i, stream.readFloat());
+
+            return true;
+        }
+    };
+
+    static GoldenTests goldenTests;
+}
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    PerformanceTests.cpp
+
+    Measures how many times faster than real time each configuration runs.
+    The numbers are always logged; the limits are only enforced in optimised
+    builds (MBC_ENFORCE_PERF_THRESHOLDS), and they are deliberately loose so
+    they catch real regressions rather than a busy CI machine.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class PerformanceTests : public juce::UnitTest
+    {
+    public:
+        PerformanceTests() : juce::UnitTest("Throughput", testCategory) {}
+
+        void runTest() override
+        {
+            struct Config
+            {
+                const char* name;
+                bool spectral;
+                int numBands;
+                double minRealtimeFactor;
+            };
+
+            constexpr std::array<Config, 4> configs
+            { {
+                { "Crossover",          false, 0,  50.0 },
+                { "Spectral, 8 bands",  true,  8,  10.0 },
+                { "Spectral, 32 bands", true,  32, 10.0 },
+                { "Spectral, 64 bands", true,  64, 10.0 },
+            } };
+
+            std::array<double, configs.size()> realtimeFactors{};
+
+            for (size_t i = 0; i < configs.size(); ++i)
+            {
+                const auto& config = configs[i];
+                beginTest(config.name);
+
+                ProcessorHarness harness(48000.0, 512);
+                harness.setAllBands(Names::thresholdLowBand, -30.f);
+                harness.setAllRatios(4.f);
+                harness.set(Names::spectralMode, config.spectral ? 1.f : 0.f);
+                if (config.spectral)
+                    harness.set(Names::spectralBandCount, static_cast<float>(config.numBands));
+
+                realtimeFactors[i] = measureRealtimeFactor(harness);
+                logMessage(juce::String(config.name) + ": " + juce::String(realtimeFactors[i], 1) + "x real time");
+
+               #if MBC_ENFORCE_PERF_THRESHOLDS
+                expectGreaterThan(realtimeFactors[i], config.minRealtimeFactor);
+               #endif
+            }
+
+            // Spectral mode does one FFT pair per hop whatever the band count,
+            // only the per-band envelopes scale with it.
+            beginTest("Spectral cost barely depends on the band count");
+            {
+                auto ratio = realtimeFactors[1] / realtimeFactors[3];
+                logMessage("8 bands run " + juce::String(ratio, 2) + "x as fast as 64 bands");
+
+               #if MBC_ENFORCE_PERF_THRESHOLDS
+                expectLessThan(ratio, 1.5);
+               #else
+                expect(ratio > 0.0);
+               #endif
+            }
+        }
+
+    private:
+        double measureRealtimeFactor(ProcessorHarness& harness)
+        {
+            constexpr double seconds = 5.0;
+            auto buffer = makeNoise(2, harness.blockSize, 0.5f);
+            auto input = buffer;
+
+            // warm up caches and let the envelopes settle
+            for (int i = 0; i < 20; ++i)
+                harness.process(buffer, 0, harness.blockSize);
+
+            auto numBlocks = static_cast<int>(seconds * harness.sampleRate / harness.blockSize);
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                buffer.makeCopyOf(input, true);
+                harness.process(buffer, 0, harness.blockSize);
+            }
+
+            auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            return numBlocks * harness.blockSize / harness.sampleRate / juce::jmax(elapsed, 1.0e-9);
+        }
+    };
+
+    static PerformanceTests performanceTests;
+}
@@ -0,0 +1,295 @@
+/*
+  ==============================================================================
+
+    PipelineTests.cpp
+
+    Pipelined Processing: same sound one block later, a chunk the worker is
+    late with plays as silence without shifting anything after it, the worker
+    only runs while the mode is on, and everything the host hears about
+    (latency, the quality tier) comes from the audio thread, never from the worker.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class PipelineTests : public juce::UnitTest
+    {
+    public:
+        PipelineTests() : juce::UnitTest("Pipelined Processing", testCategory) {}
+
+        void runTest() override
+        {
+            beginTest("Output matches direct processing one block later");
+            testMatchesDirectProcessing();
+
+            beginTest("A late chunk plays as silence and the rest stays in time");
+            testLateChunk();
+
+            beginTest("Host blocks larger than prepared stay in time");
+            testLargeHostBlocks();
+
+            beginTest("Offline renders wait for the worker");
+            testOfflineRender();
+
+            beginTest("Switching the mode on and off changes the latency");
+            testLatency();
+
+            beginTest("Host notifications come from the audio thread");
+            testHostNotifications();
+        }
+
+    private:
+        static constexpr int numChannels = 2;
+        static constexpr double sampleRate = 48000.0;
+        static constexpr int blockSize = 512;
+
+        // One host block per block period like a host, so the worker gets its
+        // time even on a single core.
+        static void renderInRealTime(ProcessorHarness& harness, juce::AudioBuffer<float>& buffer, int hostBlockSize = 0)
+        {
+            if (hostBlockSize <= 0)
+                hostBlockSize = harness.blockSize;
+
+            auto blockMilliseconds = static_cast<int>(1000.0 * hostBlockSize / harness.sampleRate) + 1;
+
+            for (int startSample = 0; startSample < buffer.getNumSamples(); startSample += hostBlockSize)
+            {
+                harness.process(buffer, startSample, juce::jmin(hostBlockSize, buffer.getNumSamples() - startSample));
+                juce::Thread::sleep(blockMilliseconds);
+            }
+        }
+
+        static void setUpCompression(ProcessorHarness& harness)
+        {
+            harness.setAllBands(Names::thresholdLowBand, -24.f);
+            harness.setAllBands(Names::attackLowBand, 10.f);
+            harness.setAllRatios(4.f);
+        }
+
+        static bool isSilent(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+        {
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                if (buffer.getMagnitude(ch, startSample, numSamples) > 0.f)
+                    return false;
+
+            return true;
+        }
+
+        // Every block of the pipelined output after the first must be the
+        // direct output one block earlier, or silence if the worker was late
+        // with it. Returns which blocks were silenced.
+        juce::Array<int> checkAgainstDirect(const juce::AudioBuffer<float>& pipelined, const juce::AudioBuffer<float>& direct)
+        {
+            juce::Array<int> silentBlocks;
+
+            for (int startSample = blockSize; startSample + blockSize <= direct.getNumSamples(); startSample += blockSize)
+            {
+                auto difference = 0.f;
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int i = startSample; i < startSample + blockSize; ++i)
+                        difference = juce::jmax(difference, std::abs(pipelined.getSample(ch, i) - direct.getSample(ch, i - blockSize)));
+
+                if (difference > 0.f && isSilent(pipelined, startSample, blockSize))
+                    silentBlocks.add(startSample / blockSize);
+                else
+                    expectEquals(difference, 0.f, "block " + juce::String(startSample / blockSize));
+            }
+
+            return silentBlocks;
+        }
+
+        void testMatchesDirectProcessing()
+        {
+            auto direct = makeNoise(numChannels, 64 * blockSize, 0.5f);
+            auto pipelined = direct;
+
+            ProcessorHarness directHarness(sampleRate, blockSize);
+            setUpCompression(directHarness);
+            directHarness.render(direct);
+
+            ProcessorHarness pipelinedHarness(sampleRate, blockSize);
+            setUpCompression(pipelinedHarness);
+            pipelinedHarness.set(Names::pipelinedProcessing, 1.f);
+            renderInRealTime(pipelinedHarness, pipelined);
+
+            auto overruns = pipelinedHarness.processor.getNumPipelineOverruns();
+            expectEquals(checkAgainstDirect(pipelined, direct).size(), overruns, "silent blocks");
+
+            if (overruns > 0)
+                logMessage("The worker overran " + juce::String(overruns) + " times on this machine");
+        }
+
+        // The worker is held back while one chunk is due, the way another
+        // process taking its core would. That one block is silent, the late
+        // result is dropped rather than played a block late, and the chain
+        // still got every chunk of input, so the output after it matches again.
+        void testLateChunk()
+        {
+            constexpr int lateBlock = 8;
+
+            auto direct = makeNoise(numChannels, 16 * blockSize, 0.5f);
+            auto pipelined = direct;
+
+            ProcessorHarness directHarness(sampleRate, blockSize);
+            setUpCompression(directHarness);
+            directHarness.render(direct);
+
+            ProcessorHarness pipelinedHarness(sampleRate, blockSize);
+            setUpCompression(pipelinedHarness);
+            pipelinedHarness.set(Names::pipelinedProcessing, 1.f);
+
+            auto& processor = pipelinedHarness.processor;
+            auto blockMilliseconds = static_cast<int>(1000.0 * blockSize / sampleRate) + 1;
+
+            for (int block = 0; block < direct.getNumSamples() / blockSize; ++block)
+            {
+                // the chunk submitted by the block before lateBlock is the late one
+                if (block == lateBlock - 1)
+                {
+                    while (processor.pipelineCompleted.load() < processor.pipelineSubmitted.load())
+                        juce::Thread::yield();
+
+                    while (processor.pipelineChainBusy.exchange(true))
+                        juce::Thread::yield();
+                }
+
+                pipelinedHarness.process(pipelined, block * blockSize, blockSize);
+
+                if (block == lateBlock)
+                {
+                    processor.pipelineChainBusy.store(false);
+                    processor.pipelineSignal.signal();
+                }
+
+                juce::Thread::sleep(blockMilliseconds);
+            }
+
+            auto silentBlocks = checkAgainstDirect(pipelined, direct);
+            expect(silentBlocks.contains(lateBlock), "the late block is silent");
+            expectEquals(silentBlocks.size(), processor.getNumPipelineOverruns(), "silent blocks");
+        }
+
+        // A host block of two prepared blocks holds two chunks. The worker
+        // gets until the second one starts playing, not a quarter block after
+        // it was handed over, which would be too short for the spectral mode.
+        void testLargeHostBlocks()
+        {
+            auto direct = makeNoise(numChannels, 64 * blockSize, 0.5f);
+            auto pipelined = direct;
+
+            ProcessorHarness directHarness(sampleRate, blockSize);
+            directHarness.set(Names::spectralMode, 1.f);
+            directHarness.render(direct);
+
+            ProcessorHarness pipelinedHarness(sampleRate, blockSize);
+            pipelinedHarness.set(Names::spectralMode, 1.f);
+            pipelinedHarness.set(Names::pipelinedProcessing, 1.f);
+            renderInRealTime(pipelinedHarness, pipelined, 2 * blockSize);
+
+            auto overruns = pipelinedHarness.processor.getNumPipelineOverruns();
+            expectEquals(checkAgainstDirect(pipelined, direct).size(), overruns, "silent blocks");
+
+           #if MBC_ENFORCE_PERF_THRESHOLDS
+            expectEquals(overruns, 0, "overruns");
+           #else
+            logMessage("Overruns: " + juce::String(overruns));
+           #endif
+        }
+
+        // Without a deadline to keep, offline renders wait as long as the
+        // worker needs, however fast the host calls.
+        void testOfflineRender()
+        {
+            auto direct = makeNoise(numChannels, 32 * blockSize, 0.5f);
+            auto pipelined = direct;
+
+            ProcessorHarness directHarness(sampleRate, blockSize);
+            directHarness.set(Names::spectralMode, 1.f);
+            directHarness.render(direct);
+
+            ProcessorHarness pipelinedHarness(sampleRate, blockSize);
+            pipelinedHarness.set(Names::spectralMode, 1.f);
+            pipelinedHarness.set(Names::pipelinedProcessing, 1.f);
+            pipelinedHarness.processor.setNonRealtime(true);
+            pipelinedHarness.render(pipelined);
+
+            expectEquals(pipelinedHarness.processor.getNumPipelineOverruns(), 0, "overruns");
+            expect(checkAgainstDirect(pipelined, direct).isEmpty(), "silent blocks");
+        }
+
+        void testLatency()
+        {
+            ProcessorHarness harness(sampleRate, blockSize);
+            auto buffer = makeNoise(numChannels, 4 * blockSize, 0.5f);
+
+            harness.set(Names::pipelinedProcessing, 1.f);
+            renderInRealTime(harness, buffer);
+            expectEquals(harness.processor.getLatencySamples(), blockSize);
+
+            harness.set(Names::spectralMode, 1.f);
+            renderInRealTime(harness, buffer);
+            expectEquals(harness.processor.getLatencySamples(), blockSize + SpectralCompressor::getLatencyInSamples());
+
+            harness.set(Names::pipelinedProcessing, 0.f);
+            renderInRealTime(harness, buffer);
+            expectEquals(harness.processor.getLatencySamples(), SpectralCompressor::getLatencyInSamples());
+
+            harness.set(Names::pipelinedProcessing, 1.f);
+            harness.prepare(sampleRate, blockSize);
+            expectEquals(harness.processor.getLatencySamples(), blockSize + SpectralCompressor::getLatencyInSamples(),
+                         "the worker is started again by prepareToPlay");
+        }
+
+        // Counts notifications that arrive on any thread but the one the test
+        // calls processBlock from.
+        struct ThreadChecker : public juce::AudioProcessorListener,
+                               public juce::AudioProcessorParameter::Listener
+        {
+            void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override  { check(); }
+            void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override { check(); ++numChanges; }
+            void parameterValueChanged(int, float) override                                  { check(); }
+            void parameterGestureChanged(int, bool) override                                 { check(); }
+
+            void check()
+            {
+                if (juce::Thread::getCurrentThreadId() != audioThread)
+                    ++numFromOtherThreads;
+            }
+
+            juce::Thread::ThreadID audioThread{ juce::Thread::getCurrentThreadId() };
+            std::atomic<int> numFromOtherThreads{ 0 };
+            std::atomic<int> numChanges{ 0 };
+        };
+
+        void testHostNotifications()
+        {
+            ProcessorHarness harness(sampleRate, blockSize);
+            harness.set(Names::pipelinedProcessing, 1.f);
+            harness.set(Names::qualityGovernor, 1.f);
+
+            ThreadChecker checker;
+            harness.processor.addListener(&checker);
+            harness.getParameter(GetParams().at(Names::qualityTier)).addListener(&checker);
+
+            // the spectral mode switch changes the latency from inside the chain,
+            // which runs on the worker
+            auto buffer = makeNoise(numChannels, 16 * blockSize, 0.5f);
+            for (auto spectral : { 1.f, 0.f, 1.f, 0.f })
+            {
+                harness.set(Names::spectralMode, spectral);
+                renderInRealTime(harness, buffer);
+            }
+
+            harness.getParameter(GetParams().at(Names::qualityTier)).removeListener(&checker);
+            harness.processor.removeListener(&checker);
+
+            expectGreaterOrEqual(checker.numChanges.load(), 4, "latency changes reported");
+            expectEquals(checker.numFromOtherThreads.load(), 0, "notifications from the worker");
+        }
+    };
+
+    static PipelineTests pipelineTests;
+}
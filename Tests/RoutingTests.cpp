@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    RoutingTests.cpp
+
+    Every mute / solo combination, checked with one sine per band: a band is
+    heard when it is soloed, or when nothing is soloed and it is not muted.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class RoutingTests : public juce::UnitTest
+    {
+    public:
+        RoutingTests() : juce::UnitTest("Routing", testCategory) {}
+
+        void runTest() override
+        {
+            beginTest("Mute and solo in crossover mode");
+            {
+                checkAllCombinations(false);
+            }
+
+            beginTest("Mute and solo in spectral mode");
+            {
+                checkAllCombinations(true);
+            }
+        }
+
+    private:
+        void checkAllCombinations(bool spectral)
+        {
+            // one sine well inside each band
+            constexpr std::array<float, 3> sineFrequencies{ 80.f, 1000.f, 12000.f };
+
+            for (int muteMask = 0; muteMask < 8; ++muteMask)
+            {
+                for (int soloMask = 0; soloMask < 8; ++soloMask)
+                {
+                    for (int band = 0; band < 3; ++band)
+                    {
+                        ProcessorHarness harness;
+                        harness.set(Names::spectralMode, spectral ? 1.f : 0.f);
+                        harness.set(Names::lowMidCrossoverFreq, 300.f);
+                        harness.set(Names::midHighCrossoverFreq, 3000.f);
+                        harness.setAllBands(Names::bypassedLowBand, 1.f);
+
+                        for (int b = 0; b < 3; ++b)
+                        {
+                            harness.set(static_cast<Names>(Names::muteLowBand + b), (muteMask >> b) & 1 ? 1.f : 0.f);
+                            harness.set(static_cast<Names>(Names::soloLowBand + b), (soloMask >> b) & 1 ? 1.f : 0.f);
+                        }
+
+                        auto audible = soloMask != 0 ? ((soloMask >> band) & 1) != 0
+                                                     : ((muteMask >> band) & 1) == 0;
+
+                        auto buffer = makeSine(2, 16384, harness.sampleRate, sineFrequencies[static_cast<size_t>(band)], 0.5f);
+                        harness.render(buffer);
+
+                        auto level = sineLevelDecibels(buffer, 12288);
+                        auto description = juce::String("mute ") + juce::String(muteMask) + ", solo " + juce::String(soloMask)
+                                         + ", band " + juce::String(band);
+
+                        if (audible)
+                            expectWithinAbsoluteError(level, juce::Decibels::gainToDecibels(0.5f), 1.f, description);
+                        else
+                            expectLessThan(level, -40.f, description);
+                    }
+                }
+            }
+        }
+    };
+
+    static RoutingTests routingTests;
+}
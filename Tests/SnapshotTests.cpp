@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    SnapshotTests.cpp
+
+    getDspState / setDspState: snapshots survive a round trip through a
+    MemoryBlock, and a render split into chunks on separate instances
+    matches the same render done in one go, both when each chunk is
+    restored from a snapshot and when it is warmed up on the preceding audio.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace params
+{
+    class SnapshotTests : public juce::UnitTest
+    {
+    public:
+        SnapshotTests() : juce::UnitTest("DSP Snapshot", testCategory) {}
+
+        void runTest() override
+        {
+            for (const auto& setup : getSetups())
+            {
+                beginTest(setup.name + ": snapshot round trip is exact");
+                testRoundTrip(setup);
+
+                beginTest(setup.name + ": chunked render matches the linear render");
+                testChunkedRender(setup);
+            }
+
+            beginTest("Snapshots that do not fit are rejected");
+            testRejection();
+        }
+
+    private:
+        static constexpr int numChannels = 2;
+        static constexpr double sampleRate = 48000.0;
+        static constexpr int blockSize = 512;
+
+        // multiples of both spectral hop sizes, so every chunk starts on a frame boundary
+        static constexpr int chunkLength = 16 * SpectralCompressor::fftSize;
+        static constexpr int numChunks = 4;
+        static constexpr int warmUpLength = 16 * SpectralCompressor::fftSize;
+
+        struct Setup
+        {
+            juce::String name;
+            bool spectral;
+            int numBands;
+        };
+
+        // 13 bands is not what a fresh engine starts with, so a restored
+        // snapshot has to bring its own band layout along
+        static std::vector<Setup> getSetups()
+        {
+            return { { "Crossover", false, 32 }, { "Spectral", true, 32 }, { "Spectral, 13 bands", true, 13 } };
+        }
+
+        static void setUp(ProcessorHarness& harness, const Setup& setup)
+        {
+            harness.set(Names::lowMidCrossoverFreq, 250.f);
+            harness.set(Names::midHighCrossoverFreq, 4000.f);
+            harness.setAllBands(Names::thresholdLowBand, -24.f);
+            harness.setAllBands(Names::attackLowBand, 10.f);
+            harness.setAllBands(Names::releaseLowBand, 100.f);
+            harness.setAllRatios(4.f);
+            harness.set(Names::spectralMode, setup.spectral ? 1.f : 0.f);
+            harness.set(Names::spectralBandCount, static_cast<float>(setup.numBands));
+        }
+
+        static juce::MemoryBlock getSnapshot(ProcessorHarness& harness)
+        {
+            juce::MemoryBlock snapshot;
+            harness.processor.getDspState(snapshot);
+            return snapshot;
+        }
+
+        static bool restore(ProcessorHarness& harness, const juce::MemoryBlock& snapshot)
+        {
+            return harness.processor.setDspState(snapshot.getData(), static_cast<int>(snapshot.getSize()));
+        }
+
+        void testRoundTrip(const Setup& setup)
+        {
+            ProcessorHarness original(sampleRate, blockSize);
+            setUp(original, setup);
+
+            auto input = makeNoise(numChannels, chunkLength, 0.5f, 1);
+            original.render(input);
+
+            auto snapshot = getSnapshot(original);
+
+            ProcessorHarness copy(sampleRate, blockSize);
+            setUp(copy, setup);
+
+            expect(restore(copy, snapshot));
+            expect(getSnapshot(copy) == snapshot, "a restored instance snapshots to the same bytes");
+
+            auto originalOutput = makeNoise(numChannels, chunkLength, 0.5f, 2);
+            auto copyOutput = makeNoise(numChannels, chunkLength, 0.5f, 2);
+
+            original.render(originalOutput);
+            copy.render(copyOutput);
+
+            expectEquals(maxAbsDifference(originalOutput, copyOutput), 0.f);
+        }
+
+        void testChunkedRender(const Setup& setup)
+        {
+            auto input = makeNoise(numChannels, numChunks * chunkLength, 0.5f, 3);
+
+            // the linear render, taking a snapshot at every chunk boundary
+            auto linear = input;
+            std::vector<juce::MemoryBlock> snapshots;
+            {
+                ProcessorHarness harness(sampleRate, blockSize);
+                setUp(harness, setup);
+
+                for (int chunk = 0; chunk < numChunks; ++chunk)
+                {
+                    snapshots.push_back(getSnapshot(harness));
+
+                    juce::AudioBuffer<float> chunkBuffer(linear.getArrayOfWritePointers(), numChannels, chunk * chunkLength, chunkLength);
+                    harness.render(chunkBuffer);
+                }
+            }
+
+            auto restored = input;
+            auto warmedUp = input;
+
+            for (int chunk = 0; chunk < numChunks; ++chunk)
+            {
+                auto chunkStart = chunk * chunkLength;
+
+                {
+                    ProcessorHarness harness(sampleRate, blockSize);
+                    setUp(harness, setup);
+                    expect(restore(harness, snapshots[static_cast<size_t>(chunk)]));
+
+                    juce::AudioBuffer<float> chunkBuffer(restored.getArrayOfWritePointers(), numChannels, chunkStart, chunkLength);
+                    harness.render(chunkBuffer);
+                }
+
+                {
+                    ProcessorHarness harness(sampleRate, blockSize);
+                    setUp(harness, setup);
+
+                    auto warmUpStart = juce::jmax(0, chunkStart - warmUpLength);
+                    juce::AudioBuffer<float> warmUp(numChannels, chunkStart - warmUpStart);
+
+                    for (int ch = 0; ch < numChannels; ++ch)
+                        warmUp.copyFrom(ch, 0, input, ch, warmUpStart, warmUp.getNumSamples());
+
+                    harness.render(warmUp);
+
+                    juce::AudioBuffer<float> chunkBuffer(warmedUp.getArrayOfWritePointers(), numChannels, chunkStart, chunkLength);
+                    harness.render(chunkBuffer);
+                }
+            }
+
+            expectEquals(maxAbsDifference(restored, linear), 0.f, "restored from snapshots");
+            expectLessThan(maxAbsDifference(warmedUp, linear), 1.0e-4f, "warmed up on the preceding audio");
+        }
+
+        void testRejection()
+        {
+            ProcessorHarness source(sampleRate, blockSize);
+            auto input = makeNoise(numChannels, chunkLength, 0.5f, 4);
+            source.render(input);
+
+            auto snapshot = getSnapshot(source);
+
+            ProcessorHarness otherRate(44100.0, blockSize);
+            auto otherRateSnapshot = getSnapshot(otherRate);
+
+            expect(!restore(otherRate, snapshot), "snapshot from another sample rate");
+            expect(getSnapshot(otherRate) == otherRateSnapshot, "a rejected snapshot leaves the state as it was");
+
+            ProcessorHarness target(sampleRate, blockSize);
+            auto targetSnapshot = getSnapshot(target);
+
+            expect(!target.processor.setDspState(snapshot.getData(), static_cast<int>(snapshot.getSize()) / 2), "truncated snapshot");
+            expect(getSnapshot(target) == targetSnapshot, "a truncated snapshot leaves the state as it was");
+
+            expect(!target.processor.setDspState(nullptr, 0), "no data");
+        }
+    };
+
+    static SnapshotTests snapshotTests;
+}
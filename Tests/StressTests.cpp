@@ -0,0 +1,428 @@
+/*
+  ==============================================================================
+
+    StressTests.cpp
+
+    Randomised sessions that behave like a badly behaved host: block sizes of
+    0, 1 and more than announced, prepareToPlay in the middle of playback,
+    automation of every parameter, NaN / Inf / denormal / huge input and junk
+    passed to setStateInformation. Every block must come back finite, without
+    touching the heap (malloc and free included, on Linux) and within its
+    real-time budget.
+
+    The seed is printed at the start of the run, MBC_TEST_SEED repeats it.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+#include "AllocationCounter.h"
+
+namespace params
+{
+    class StressTests : public juce::UnitTest
+    {
+    public:
+        StressTests() : juce::UnitTest("Stress", testCategory) {}
+
+        void runTest() override
+        {
+            auto random = getRandom();
+
+            // each session starts in a different mode so every path gets
+            // hammered, the toggles below then mix them up
+            beginTest("Random sessions");
+            {
+                for (int session = 0; session < 12; ++session)
+                    runSession(random, session);
+            }
+
+            beginTest("Junk state blobs");
+            {
+                ProcessorHarness harness(48000.0, 256);
+
+                for (int i = 0; i < 500; ++i)
+                {
+                    setJunkState(harness, random);
+
+                    auto block = makeNoise(2, 256, 0.5f, static_cast<juce::uint32>(i));
+                    harness.process(block, 0, 256);
+                    expect(isFinite(block, 256), "output after junk state " + juce::String(i));
+                }
+            }
+
+            beginTest("Blocks of another size than prepared stay off the heap");
+            {
+                if (!canCountMalloc())
+                    logMessage("Only operator new is counted in this build, AudioBuffer reallocations are not seen");
+
+                for (auto spectral : { false, true })
+                    checkOddBlockSizes(spectral);
+            }
+
+            beginTest("Denormal input costs no more than normal input");
+            {
+                for (auto spectral : { false, true })
+                    checkDenormalCost(spectral);
+            }
+        }
+
+    private:
+        static constexpr int numChannels = 2;
+        static constexpr int maxPreparedBlockSize = 2048;
+        static constexpr int maxBlockSize = 4 * maxPreparedBlockSize + 3;
+        static constexpr int maxLateBlocks = 2;
+
+        enum Mode
+        {
+            crossoverMode,
+            spectralMode,
+            governedSpectralMode,
+            pipelinedMode,
+            pipelinedSpectralMode,
+
+            numModes
+        };
+
+        struct Stats
+        {
+            int numBlocks{ 0 };
+            int numNonFiniteBlocks{ 0 };
+            int numAllocatingBlocks{ 0 };
+            int numLateBlocks{ 0 };
+            double worstLoad{ 0.0 };
+            std::array<int, QualityGovernor::numTiers> tierBlocks{};
+        };
+
+        //==============================================================================
+        void runSession(juce::Random& random, int session)
+        {
+            ProcessorHarness harness(randomSampleRate(random), randomPreparedBlockSize(random));
+            setMode(harness, static_cast<Mode>(session % numModes));
+
+            // allocated up front so the loop itself never allocates
+            juce::AudioBuffer<float> buffer(numChannels, maxBlockSize);
+            Stats stats;
+
+            for (int step = 0; step < 1500; ++step)
+            {
+                auto action = random.nextInt(100);
+
+                if (action < 75)
+                    processRandomBlock(harness, buffer, random, stats);
+                else if (action < 88)
+                    automate(harness, random);
+                else if (action < 93)
+                    setMode(harness, static_cast<Mode>(random.nextInt(numModes)));
+                else if (action < 96)
+                    harness.prepare(randomSampleRate(random), randomPreparedBlockSize(random));
+                else
+                    setJunkState(harness, random);
+            }
+
+            auto description = "session " + juce::String(session);
+            logMessage(description + ": " + juce::String(stats.numBlocks) + " blocks, worst load "
+                       + juce::String(stats.worstLoad, 2) + " (" + juce::String(stats.numLateBlocks) + " late), blocks per tier "
+                       + juce::String(stats.tierBlocks[0]) + " / " + juce::String(stats.tierBlocks[1]) + " / "
+                       + juce::String(stats.tierBlocks[2]) + ", pipeline overruns "
+                       + juce::String(harness.processor.getNumPipelineOverruns()));
+
+            expectEquals(stats.numNonFiniteBlocks, 0, description + ", blocks with non-finite output");
+            expectEquals(stats.numAllocatingBlocks, 0, description + ", blocks that allocated or freed");
+
+           #if MBC_ENFORCE_PERF_THRESHOLDS
+            // a single late block can be the OS scheduling something else,
+            // a plugin that spikes does it again
+            expectLessOrEqual(stats.numLateBlocks, maxLateBlocks, description + ", blocks over their real-time budget");
+           #endif
+        }
+
+        void processRandomBlock(ProcessorHarness& harness, juce::AudioBuffer<float>& buffer, juce::Random& random, Stats& stats)
+        {
+            auto preparedSize = harness.blockSize;
+            int numSamples = 0;
+
+            switch (random.nextInt(6))
+            {
+                case 0:  numSamples = 0; break;
+                case 1:  numSamples = 1; break;
+                case 2:  numSamples = 2 + random.nextInt(15); break;
+                case 3:  numSamples = 1 + random.nextInt(preparedSize); break;
+                case 4:  numSamples = preparedSize; break;
+                default: numSamples = preparedSize + 1 + random.nextInt(3 * preparedSize + 2); break;
+            }
+
+            fillInput(buffer, numSamples, random);
+
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, 0, numSamples);
+
+            auto heapOperationsBefore = getNumHeapOperations();
+            auto startTicks = juce::Time::getHighResolutionTicks();
+
+            harness.processor.processBlock(block, harness.midi);
+
+            auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            auto heapOperations = getNumHeapOperations() - heapOperationsBefore;
+
+            // a block shorter than announced still gets the whole period of a
+            // prepared block, the host has to call at that rate anyway. The
+            // spectral engine transforms one frame per hop, so with blocks
+            // shorter than a hop that frame lands in a single block and only
+            // the hop as a whole has to keep up.
+            auto budgetSamples = juce::jmax(numSamples, preparedSize);
+
+            if (harness.getParameter(GetParams().at(Names::spectralMode)).getValue() > 0.5f)
+                budgetSamples = juce::jmax(budgetSamples, SpectralCompressor::fftSize / 4);
+
+            auto budget = budgetSamples / harness.sampleRate;
+
+            ++stats.numBlocks;
+            stats.numNonFiniteBlocks += isFinite(block, numSamples) ? 0 : 1;
+            stats.numAllocatingBlocks += heapOperations > 0 ? 1 : 0;
+
+            // on a single core the worker can only run in place of the audio
+            // thread, so its time would be counted against the block as well
+            auto pipelined = harness.getParameter(GetParams().at(Names::pipelinedProcessing)).getValue() > 0.5f;
+            if (!pipelined || juce::SystemStats::getNumCpus() > 1)
+            {
+                stats.worstLoad = juce::jmax(stats.worstLoad, elapsed / budget);
+                stats.numLateBlocks += elapsed > budget ? 1 : 0;
+            }
+
+            auto tier = getChoice(harness, Names::qualityTier);
+            ++stats.tierBlocks[static_cast<size_t>(juce::jlimit(0, QualityGovernor::numTiers - 1, tier))];
+        }
+
+        static int getNumHeapOperations()
+        {
+            return getNumAllocations() + getNumDeallocations();
+        }
+
+        //==============================================================================
+        static double randomSampleRate(juce::Random& random)
+        {
+            constexpr std::array<double, 7> sampleRates{ 22050.0, 32000.0, 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+            return sampleRates[static_cast<size_t>(random.nextInt(static_cast<int>(sampleRates.size())))];
+        }
+
+        static int randomPreparedBlockSize(juce::Random& random)
+        {
+            constexpr std::array<int, 8> blockSizes{ 64, 128, 256, 441, 480, 512, 1024, maxPreparedBlockSize };
+            return blockSizes[static_cast<size_t>(random.nextInt(static_cast<int>(blockSizes.size())))];
+        }
+
+        static void setMode(ProcessorHarness& harness, Mode mode)
+        {
+            auto spectral = mode == spectralMode || mode == governedSpectralMode || mode == pipelinedSpectralMode;
+            auto pipelined = mode == pipelinedMode || mode == pipelinedSpectralMode;
+
+            harness.set(Names::spectralMode, spectral ? 1.f : 0.f);
+            harness.set(Names::qualityGovernor, mode == governedSpectralMode ? 1.f : 0.f);
+            harness.set(Names::pipelinedProcessing, pipelined ? 1.f : 0.f);
+        }
+
+        static int getChoice(ProcessorHarness& harness, Names name)
+        {
+            auto* param = dynamic_cast<juce::AudioParameterChoice*>(&harness.getParameter(GetParams().at(name)));
+            return param != nullptr ? param->getIndex() : 0;
+        }
+
+        // What a host does with automation lanes: any automatable parameter,
+        // anywhere in its range, including both ends.
+        static void automate(ProcessorHarness& harness, juce::Random& random)
+        {
+            const auto& parameters = harness.processor.getParameters();
+            auto numChanges = 1 + random.nextInt(8);
+
+            for (int i = 0; i < numChanges; ++i)
+            {
+                auto* param = parameters[random.nextInt(parameters.size())];
+                if (!param->isAutomatable())
+                    continue;
+
+                auto value = random.nextInt(4) == 0 ? static_cast<float>(random.nextInt(2)) : random.nextFloat();
+                param->setValueNotifyingHost(value);
+            }
+        }
+
+        static void fillInput(juce::AudioBuffer<float>& buffer, int numSamples, juce::Random& random)
+        {
+            auto kind = random.nextInt(8);
+            auto amplitude = random.nextFloat();
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto* data = buffer.getWritePointer(ch);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    auto noise = 2.f * random.nextFloat() - 1.f;
+
+                    switch (kind)
+                    {
+                        case 0:  data[i] = amplitude * noise; break;
+                        case 1:  data[i] = 0.f; break;
+                        case 2:  data[i] = noise * std::numeric_limits<float>::denorm_min() * 1000.f; break;
+                        case 3:  data[i] = random.nextInt(50) == 0 ? std::numeric_limits<float>::quiet_NaN() : noise; break;
+                        case 4:  data[i] = random.nextInt(50) == 0 ? std::copysign(std::numeric_limits<float>::infinity(), noise) : noise; break;
+                        case 5:  data[i] = noise * 1.0e30f; break;
+                        case 6:  data[i] = (i / 64) % 2 == 0 ? 1.f : -1.f; break;
+                        default: data[i] = 1.f; break;
+                    }
+                }
+            }
+        }
+
+        static bool isFinite(const juce::AudioBuffer<float>& buffer, int numSamples)
+        {
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            {
+                const auto* data = buffer.getReadPointer(ch);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    if (!std::isfinite(data[i]))
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        //==============================================================================
+        static void setJunkState(ProcessorHarness& harness, juce::Random& random)
+        {
+            auto& processor = harness.processor;
+
+            juce::MemoryBlock state;
+            processor.getStateInformation(state);
+
+            switch (random.nextInt(5))
+            {
+                case 0:
+                {
+                    juce::MemoryBlock junk(static_cast<size_t>(random.nextInt(2048)), true);
+                    for (size_t i = 0; i < junk.getSize(); ++i)
+                        junk[i] = static_cast<char>(random.nextInt(256));
+
+                    processor.setStateInformation(junk.getData(), static_cast<int>(junk.getSize()));
+                    break;
+                }
+
+                case 1:
+                    processor.setStateInformation(state.getData(), random.nextInt(static_cast<int>(state.getSize())));
+                    break;
+
+                case 2:
+                {
+                    for (int flips = 1 + random.nextInt(16); --flips >= 0;)
+                        state[static_cast<size_t>(random.nextInt(static_cast<int>(state.getSize())))] ^= static_cast<char>(1 << random.nextInt(8));
+
+                    processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+                    break;
+                }
+
+                case 3:
+                {
+                    // well formed, but with values no host should ever send
+                    static const juce::StringArray junkValues{ "nan", "-nan", "inf", "-inf", "1e30", "-1e30", "", "garbage" };
+
+                    auto tree = processor.aptvs.copyState();
+                    for (int i = 0; i < tree.getNumChildren(); ++i)
+                    {
+                        if (random.nextInt(4) == 0)
+                            tree.getChild(i).setProperty("value", junkValues[random.nextInt(junkValues.size())], nullptr);
+                    }
+
+                    juce::MemoryBlock data;
+                    {
+                        juce::MemoryOutputStream stream(data, false);
+                        tree.writeToStream(stream);
+                    }
+
+                    processor.setStateInformation(data.getData(), static_cast<int>(data.getSize()));
+                    break;
+                }
+
+                default:
+                    processor.setStateInformation(nullptr, 0);
+                    break;
+            }
+        }
+
+        //==============================================================================
+        // AudioBuffer reallocates whenever it is assigned or resized to another
+        // size, so copying a host block into one of the prepared buffers only
+        // shows up once the host sends a block size other than the prepared one.
+        void checkOddBlockSizes(bool spectral)
+        {
+            ProcessorHarness harness(48000.0, 512);
+            harness.set(Names::spectralMode, spectral ? 1.f : 0.f);
+            harness.setAllBands(Names::thresholdLowBand, -24.f);
+
+            auto input = makeNoise(numChannels, maxBlockSize, 0.5f);
+            juce::AudioBuffer<float> buffer(numChannels, maxBlockSize);
+
+            for (auto numSamples : { 512, 100, 1, 511, 513, 1500, 512 })
+            {
+                buffer.makeCopyOf(input, true);
+                juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, 0, numSamples);
+
+                auto heapOperationsBefore = getNumHeapOperations();
+                harness.processor.processBlock(block, harness.midi);
+                auto heapOperations = getNumHeapOperations() - heapOperationsBefore;
+
+                expectEquals(heapOperations, 0,
+                             juce::String(spectral ? "Spectral" : "Crossover") + ", block of " + juce::String(numSamples) + " samples");
+            }
+        }
+
+        //==============================================================================
+        // Without flush-to-zero, IIR tails and envelopes decaying into the
+        // denormal range can make processing many times slower.
+        void checkDenormalCost(bool spectral)
+        {
+            ProcessorHarness harness(48000.0, 512);
+            harness.set(Names::spectralMode, spectral ? 1.f : 0.f);
+            harness.setAllBands(Names::thresholdLowBand, -30.f);
+            harness.setAllRatios(4.f);
+
+            auto noise = makeNoise(numChannels, 512, 0.5f);
+            juce::AudioBuffer<float> buffer(numChannels, 512);
+
+            auto timeBlocks = [&](auto&& fill)
+            {
+                auto startTicks = juce::Time::getHighResolutionTicks();
+
+                for (int i = 0; i < 400; ++i)
+                {
+                    fill();
+                    harness.process(buffer, 0, 512);
+                }
+
+                return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            };
+
+            auto normal = timeBlocks([&] { buffer.makeCopyOf(noise, true); });
+            auto decaying = timeBlocks([&] { buffer.clear(); });
+            auto denormal = timeBlocks([&]
+            {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int i = 0; i < 512; ++i)
+                        buffer.setSample(ch, i, noise.getSample(ch, i) * 1.0e-38f);
+            });
+
+            auto worst = juce::jmax(decaying, denormal) / normal;
+            logMessage(juce::String(spectral ? "Spectral" : "Crossover") + ": silent tail and denormal input take up to "
+                       + juce::String(worst, 2) + "x the time of normal input");
+
+           #if MBC_ENFORCE_PERF_THRESHOLDS
+            expectLessThan(worst, 2.0);
+           #else
+            expect(worst > 0.0);
+           #endif
+        }
+    };
+
+    static StressTests stressTests;
+}
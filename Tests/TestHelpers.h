@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    TestHelpers.h
+
+    Shared pieces of the headless tests: a processor that can be driven
+    through its parameters, and deterministic test signals.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+
+namespace params
+{
+    inline const juce::String testCategory{ "MultiBandCompressor" };
+
+    // Owns a prepared processor and feeds it audio in host sized blocks.
+    struct ProcessorHarness
+    {
+        ProcessorHarness(double newSampleRate = 48000.0, int newBlockSize = 512)
+        {
+            prepare(newSampleRate, newBlockSize);
+        }
+
+        void prepare(double newSampleRate, int newBlockSize)
+        {
+            sampleRate = newSampleRate;
+            blockSize = newBlockSize;
+            processor.prepareToPlay(sampleRate, blockSize);
+        }
+
+        juce::RangedAudioParameter& getParameter(const juce::String& id)
+        {
+            auto* param = processor.aptvs.getParameter(id);
+            jassert(param != nullptr);
+            return *param;
+        }
+
+        // Plain parameter value, i.e. Hz / ms / dB, 0 or 1 for switches
+        // and the choice index for choice parameters.
+        void set(const juce::String& id, float value)
+        {
+            auto& param = getParameter(id);
+            param.setValueNotifyingHost(param.convertTo0to1(value));
+        }
+
+        void set(Names name, float value)
+        {
+            set(GetParams().at(name), value);
+        }
+
+        void setRatio(Names name, float ratio)
+        {
+            auto* param = dynamic_cast<juce::AudioParameterChoice*>(&getParameter(GetParams().at(name)));
+            jassert(param != nullptr);
+
+            auto index = param->choices.indexOf(juce::String(ratio, 1));
+            jassert(index >= 0);
+            set(name, static_cast<float>(index));
+        }
+
+        // Same settings on all three bands / regions.
+        void setAllBands(Names lowBandName, float value)
+        {
+            for (int band = 0; band < 3; ++band)
+                set(static_cast<Names>(lowBandName + band), value);
+        }
+
+        void setAllRatios(float ratio)
+        {
+            for (auto name : { Names::ratioLowBand, Names::ratioMidBand, Names::ratioHighBand })
+                setRatio(name, ratio);
+        }
+
+        void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+        {
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), startSample, numSamples);
+            processor.processBlock(block, midi);
+        }
+
+        // Processes the buffer in place, blockSize samples at a time.
+        void render(juce::AudioBuffer<float>& buffer)
+        {
+            for (int startSample = 0; startSample < buffer.getNumSamples(); startSample += blockSize)
+                process(buffer, startSample, juce::jmin(blockSize, buffer.getNumSamples() - startSample));
+        }
+
+        MultiBandCompressorAudioProcessor processor;
+        juce::MidiBuffer midi;
+        double sampleRate{ 48000.0 };
+        int blockSize{ 512 };
+    };
+
+    //==============================================================================
+    // juce::Random is not guaranteed to produce the same sequence across JUCE
+    // versions, golden renders need an input that never changes.
+    struct TestNoise
+    {
+        explicit TestNoise(juce::uint32 seed) : state(seed) {}
+
+        float next()
+        {
+            state = state * 1664525u + 1013904223u;
+            return static_cast<float>(state >> 8) / static_cast<float>(1 << 23) - 1.f;
+        }
+
+        juce::uint32 state;
+    };
+
+    inline juce::AudioBuffer<float> makeNoise(int numChannels, int numSamples, float amplitude, juce::uint32 seed = 1)
+    {
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        TestNoise noise(seed);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample(ch, i, amplitude * noise.next());
+
+        return buffer;
+    }
+
+    inline juce::AudioBuffer<float> makeSine(int numChannels, int numSamples, double sampleRate, double frequency, float amplitude)
+    {
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto value = amplitude * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * frequency * i / sampleRate));
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.setSample(ch, i, value);
+        }
+
+        return buffer;
+    }
+
+    // Level of a steady sine from startSample to the end, as the peak of a sine
+    // with the same RMS, in dB. Loudest channel wins. Sample peaks would depend
+    // on where the samples happen to fall on the waveform.
+    inline float sineLevelDecibels(const juce::AudioBuffer<float>& buffer, int startSample)
+    {
+        auto rms = 0.f;
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            rms = juce::jmax(rms, buffer.getRMSLevel(ch, startSample, buffer.getNumSamples() - startSample));
+
+        return juce::Decibels::gainToDecibels(rms * juce::MathConstants<float>::sqrt2, -200.f);
+    }
+
+    inline float maxAbsDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b, int startSample = 0)
+    {
+        jassert(a.getNumChannels() == b.getNumChannels() && a.getNumSamples() == b.getNumSamples());
+
+        auto difference = 0.f;
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            for (int i = startSample; i < a.getNumSamples(); ++i)
+                difference = juce::jmax(difference, std::abs(a.getSample(ch, i) - b.getSample(ch, i)));
+
+        return difference;
+    }
+}
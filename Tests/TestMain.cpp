@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    TestMain.cpp
+
+    Runs every MultiBandCompressor unit test, or only the ones whose names are
+    passed on the command line. MBC_TEST_SEED fixes the random seed so a
+    failing randomised run can be repeated.
+
+  ==============================================================================
+*/
+
+#include "TestHelpers.h"
+
+namespace
+{
+    class ConsoleRunner : public juce::UnitTestRunner
+    {
+        void logMessage(const juce::String& message) override
+        {
+            std::cout << message << std::endl;
+        }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::Array<juce::UnitTest*> tests;
+    for (auto* test : juce::UnitTest::getAllTests())
+    {
+        if (test->getCategory() != params::testCategory)
+            continue;
+
+        auto selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || test->getName() == juce::String(argv[i]);
+
+        if (selected)
+            tests.add(test);
+    }
+
+    if (tests.isEmpty())
+    {
+        std::cerr << "No matching tests" << std::endl;
+        return 1;
+    }
+
+    auto seed = juce::SystemStats::getEnvironmentVariable("MBC_TEST_SEED", "0").getLargeIntValue();
+    if (seed == 0)
+        seed = juce::Random::getSystemRandom().nextInt64();
+
+    std::cout << "Random seed: " << seed << std::endl;
+
+    ConsoleRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTests(tests, seed);
+
+    auto failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult(i)->failures;
+
+    return failures == 0 ? 0 : 1;
+}